@@ -1,27 +1,58 @@
 #include <assert.h> /* assert */
 #include <stdlib.h> /* malloc, free */
 
+#include "pool.h"
 #include "dlist.h"
 
+/* a node remembers its pool, so it can be freed after a splice
+    to another dlist */
 struct dlist_node
 {
     void *val;
     struct dlist_node *next;
     struct dlist_node *prev;
+    pool_t *pool;
 };
 
 struct dlist
 {
     dlist_node_t head;
     dlist_node_t tail;
+    pool_t *pool;
 };
 
 /****************************************************************************/
 
+/* to free a node to the pool that it came from */
+static void FreeNode(dlist_iterator_t node)
+{
+    if (NULL != node->pool)
+    {
+        PoolFree(node->pool, node);
+
+        return;
+    }
+
+    free(node);
+}
+
+/****************************************************************************/
+
 /* the function creates a new dlist.
     the function creates two nodes that are the head and the tail of the dlist.
     returns the dlist (or NULL if one of the allocation failed) */
 dlist_t *DLCreate(void)
+{
+    return (DLCreateWithPool(NULL));
+}
+
+/****************************************************************************/
+
+/* the function creates a new dlist that takes its nodes from a pool
+    (the pool must live longer than the dlist).
+    a NULL pool means that every node is allocated by itself.
+    returns the dlist (or NULL if the allocation failed) */
+dlist_t *DLCreateWithPool(pool_t *pool)
 {
     dlist_t *new_dlist = (dlist_t *)malloc(sizeof(dlist_t));
     if (NULL == new_dlist)
@@ -31,6 +62,9 @@ dlist_t *DLCreate(void)
    
     new_dlist->head.val = NULL;
     new_dlist->tail.val = NULL;
+    new_dlist->head.pool = NULL;
+    new_dlist->tail.pool = NULL;
+    new_dlist->pool = pool;
    
     /* to link the head and the tail together */
     new_dlist->head.next = &new_dlist->tail;
@@ -176,7 +210,7 @@ dlist_iterator_t DLErase(dlist_iterator_t to_erase)
     to_erase->prev = NULL;
     to_erase->next = NULL;
   
-    free(to_erase); to_erase = NULL;
+    FreeNode(to_erase); to_erase = NULL;
    
     return (removed);
 }
@@ -222,13 +256,16 @@ dlist_iterator_t DLInsert(dlist_iterator_t where, dlist_t *my_dlist, const void
     assert((NULL != my_dlist) && (NULL != where) && (NULL != data));
    
     /* to create a new iterator */
-    new_iter = (dlist_iterator_t)malloc(sizeof(dlist_node_t));
+    new_iter = (NULL != my_dlist->pool) ?
+               (dlist_iterator_t)PoolAlloc(my_dlist->pool) :
+               (dlist_iterator_t)malloc(sizeof(dlist_node_t));
     if (NULL == new_iter)
     {
         return (DLEnd(my_dlist));
     }
   
     new_iter->val = (void *)data;
+    new_iter->pool = my_dlist->pool;
   
     /* to set the new iteraton in its place in the dlist */
     new_iter->next = where;
@@ -301,7 +338,7 @@ void DLDestroy(dlist_t *my_dlist)
     while (0 == DLIsSameIterator(to_remove, DLEnd(my_dlist)))
     {
         remove_next = DLNext(to_remove);       
-        free(to_remove); to_remove = NULL;
+        FreeNode(to_remove); to_remove = NULL;
         to_remove = remove_next;       
     }
   
@@ -396,3 +433,11 @@ dlist_iterator_t DLFind(const dlist_iterator_t from, const dlist_iterator_t to,
   
     return (to);
 }
+
+/****************************************************************************/
+
+/* to get the size of a node, for a pool of nodes */
+size_t DLNodeSize(void)
+{
+    return (sizeof(dlist_node_t));
+}
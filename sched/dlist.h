@@ -4,6 +4,8 @@
 
 #include <stddef.h>
 
+#include "pool.h"
+
 typedef struct dlist_node * dlist_iterator_t;
 typedef struct dlist dlist_t;
 
@@ -20,6 +22,15 @@ typedef struct dlist_node dlist_node_t;
     returns a pointer to the head node (or NULL if one of the allocation failed) */
 dlist_t *DLCreate(void);
 
+/* the function creates a new dlist that takes its nodes from a pool
+    (the pool must live longer than the dlist).
+    a NULL pool means that every node is allocated by itself.
+    returns the dlist (or NULL if the allocation failed) */
+dlist_t *DLCreateWithPool(pool_t *pool);
+
+/* to get the size of a node, for a pool of nodes */
+size_t DLNodeSize(void);
+
 /* checks if the dlist is empty.
     returns 1 if true, and 0 else */
 int DLIsEmpty(const dlist_t *my_dlist);
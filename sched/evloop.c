@@ -0,0 +1,373 @@
+#define _GNU_SOURCE /* epoll, timerfd, eventfd */
+
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, free */
+#include <stdint.h> /* uint64_t */
+#include <string.h> /* memset */
+#include <unistd.h> /* read, write, close */
+#include <sys/epoll.h> /* epoll */
+#include <sys/timerfd.h> /* timerfd */
+#include <sys/eventfd.h> /* eventfd */
+
+#include "dlist.h"
+#include "evloop.h"
+
+#define EV_MAX_EVENTS 32
+#define EV_NOT_ARMED (-1)
+
+typedef struct ev_watcher
+{
+	int fd;
+	unsigned int events;
+	ev_func_t func;
+	void *arg;
+} ev_watcher_t;
+
+struct evloop
+{
+	int epoll_fd;
+	ev_watcher_t timer;
+	ev_watcher_t wake;
+	sched_time_t armed;
+	dlist_t *watchers;
+	dlist_t *removed;
+	size_t count;
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+static unsigned int ToEpoll(unsigned int events)
+{
+	return (((events & EV_IN) ? EPOLLIN : 0) | ((events & EV_OUT) ? EPOLLOUT : 0));
+}
+
+/****************************************************************************/
+
+static unsigned int FromEpoll(unsigned int events)
+{
+	return (((events & EPOLLIN) ? EV_IN : 0) | ((events & EPOLLOUT) ? EV_OUT : 0) |
+			((events & (EPOLLERR | EPOLLHUP)) ? EV_ERR : 0));
+}
+
+/****************************************************************************/
+
+static int IsWatcherFd(const void *watcher, void *fd)
+{
+	return (((const ev_watcher_t *)watcher)->fd == *(int *)fd);
+}
+
+/****************************************************************************/
+
+static int Watch(evloop_t *loop, ev_watcher_t *watcher)
+{
+	struct epoll_event event = {0};
+
+	event.events = ToEpoll(watcher->events);
+	event.data.ptr = watcher;
+
+	return (0 != epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, watcher->fd, &event));
+}
+
+/****************************************************************************/
+
+/* to arm the timerfd to an absolute deadline (only if it changed) */
+static void Arm(evloop_t *loop, sched_time_t deadline)
+{
+	struct itimerspec spec;
+
+	if (deadline == loop->armed)
+	{
+		return;
+	}
+
+	memset(&spec, 0, sizeof(spec));
+
+	/* an all zero time disarms the timer */
+	if (0 <= deadline)
+	{
+		deadline = (0 == deadline) ? 1 : deadline;
+		spec.it_value.tv_sec = (time_t)(deadline / SCH_SEC(1));
+		spec.it_value.tv_nsec = (long)(deadline % SCH_SEC(1));
+	}
+
+	timerfd_settime(loop->timer.fd, TFD_TIMER_ABSTIME, &spec, NULL);
+	loop->armed = deadline;
+}
+
+/****************************************************************************/
+
+/* to free the watchers that were removed */
+static void FreeRemoved(evloop_t *loop)
+{
+	while (0 == DLIsEmpty(loop->removed))
+	{
+		free(DLGetData(DLBegin(loop->removed)));
+		DLPopFront(loop->removed);
+	}
+}
+
+/****************************************************************************/
+
+static void CloseFds(evloop_t *loop)
+{
+	if (-1 != loop->timer.fd)
+	{
+		close(loop->timer.fd);
+	}
+
+	if (-1 != loop->wake.fd)
+	{
+		close(loop->wake.fd);
+	}
+
+	if (-1 != loop->epoll_fd)
+	{
+		close(loop->epoll_fd);
+	}
+}
+
+/****************************************************************************/
+
+/* the function creates a new event loop - an epoll instance, with a timerfd
+	for the deadline and an eventfd to wake it up.
+	returns the loop (or NULL if one of the creations failed) */
+evloop_t *EVCreate(void)
+{
+	evloop_t *new_loop = (evloop_t *)malloc(sizeof(evloop_t));
+	if (NULL == new_loop)
+	{
+		return (NULL);
+	}
+
+	new_loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	new_loop->timer.fd = timerfd_create(CLOCK_MONOTONIC,
+										TFD_NONBLOCK | TFD_CLOEXEC);
+	new_loop->timer.events = EV_IN;
+	new_loop->wake.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	new_loop->wake.events = EV_IN;
+	new_loop->armed = EV_NOT_ARMED;
+	new_loop->watchers = DLCreate();
+	new_loop->removed = DLCreate();
+	new_loop->count = 0;
+
+	if ((-1 == new_loop->epoll_fd) || (-1 == new_loop->timer.fd) ||
+		(-1 == new_loop->wake.fd) || (NULL == new_loop->watchers) ||
+		(NULL == new_loop->removed) || (0 != Watch(new_loop, &new_loop->timer)) ||
+		(0 != Watch(new_loop, &new_loop->wake)))
+	{
+		CloseFds(new_loop);
+
+		if (NULL != new_loop->watchers)
+		{
+			DLDestroy(new_loop->watchers);
+		}
+
+		if (NULL != new_loop->removed)
+		{
+			DLDestroy(new_loop->removed);
+		}
+
+		free(new_loop); new_loop = NULL;
+
+		return (NULL);
+	}
+
+	return (new_loop);
+}
+
+/****************************************************************************/
+
+/* to destroy an event loop (the fds of the user are not closed) */
+void EVDestroy(evloop_t *loop)
+{
+	/* checking parameters */
+	assert(NULL != loop);
+
+	while (0 == DLIsEmpty(loop->watchers))
+	{
+		free(DLGetData(DLBegin(loop->watchers)));
+		DLPopFront(loop->watchers);
+	}
+
+	FreeRemoved(loop);
+
+	DLDestroy(loop->watchers); loop->watchers = NULL;
+	DLDestroy(loop->removed); loop->removed = NULL;
+
+	CloseFds(loop);
+
+	free(loop); loop = NULL;
+}
+
+/****************************************************************************/
+
+/* to watch a file descriptor.
+	'func' is called from EVWait when one of 'events' happens.
+	returns 0 for success, and 1 for failure */
+int EVAddFd(evloop_t *loop, int fd, unsigned int events, ev_func_t func, void *arg)
+{
+	ev_watcher_t *watcher = NULL;
+
+	/* checking parameters */
+	assert((NULL != loop) && (0 <= fd) && (NULL != func));
+
+	watcher = (ev_watcher_t *)malloc(sizeof(ev_watcher_t));
+	if (NULL == watcher)
+	{
+		return (1);
+	}
+
+	watcher->fd = fd;
+	watcher->events = events;
+	watcher->func = func;
+	watcher->arg = arg;
+
+	if (1 == DLIsSameIterator(DLPushBack(loop->watchers, watcher),
+							  DLEnd(loop->watchers)))
+	{
+		free(watcher); watcher = NULL;
+
+		return (1);
+	}
+
+	if (0 != Watch(loop, watcher))
+	{
+		DLPopBack(loop->watchers);
+		free(watcher); watcher = NULL;
+
+		return (1);
+	}
+
+	++loop->count;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to stop watching a file descriptor (can be called from a fd func).
+	returns 0 for success, and 1 if the fd isn't watched */
+int EVRemoveFd(evloop_t *loop, int fd)
+{
+	dlist_iterator_t found = NULL;
+	ev_watcher_t *watcher = NULL;
+
+	/* checking parameters */
+	assert(NULL != loop);
+
+	found = DLFind(DLBegin(loop->watchers), DLEnd(loop->watchers),
+				   &IsWatcherFd, &fd);
+	if (1 == DLIsSameIterator(found, DLEnd(loop->watchers)))
+	{
+		return (1);
+	}
+
+	watcher = DLGetData(found);
+	epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+	/* an event of this watcher can still wait in the current batch,
+		so it's freed only at the end of EVWait */
+	watcher->fd = -1;
+	DLSplice(DLEnd(loop->removed), found, DLNext(found));
+	--loop->count;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to count how many file descriptors are watched */
+size_t EVCountFds(const evloop_t *loop)
+{
+	/* checking parameters */
+	assert(NULL != loop);
+
+	return (loop->count);
+}
+
+/****************************************************************************/
+
+/* to wait until the absolute time 'deadline' (monotonic clock), until an
+	event of a watched fd, or until EVWake is called.
+	a negative deadline means no deadline.
+	the funcs of the fds that have events are called.
+	returns 0 for success, and 1 if one of the fd funcs failed */
+int EVWait(evloop_t *loop, sched_time_t deadline)
+{
+	struct epoll_event events[EV_MAX_EVENTS];
+	ev_watcher_t *watcher = NULL;
+	uint64_t counter = 0;
+	int was_error = 0;
+	int res = 0;
+	int count = 0;
+	int i = 0;
+
+	/* checking parameters */
+	assert(NULL != loop);
+
+	Arm(loop, (0 > deadline) ? EV_NOT_ARMED : deadline);
+
+	/* a signal ends the wait too - the caller checks its state again */
+	count = epoll_wait(loop->epoll_fd, events, EV_MAX_EVENTS, -1);
+
+	for (i = 0; i < count; ++i)
+	{
+		watcher = (ev_watcher_t *)events[i].data.ptr;
+
+		if ((&loop->timer == watcher) || (&loop->wake == watcher))
+		{
+			/* to clear the fd, the timer is disarmed after it expires */
+			if (0 > read(watcher->fd, &counter, sizeof(counter)))
+			{
+				counter = 0;
+			}
+
+			if (&loop->timer == watcher)
+			{
+				loop->armed = EV_NOT_ARMED;
+			}
+
+			continue;
+		}
+
+		/* the watcher was removed by an earlier func in this batch */
+		if (-1 == watcher->fd)
+		{
+			continue;
+		}
+
+		res = watcher->func(watcher->fd, FromEpoll(events[i].events), watcher->arg);
+		if (1 != res)
+		{
+			was_error |= (-1 == res);
+
+			if (-1 != watcher->fd)
+			{
+				EVRemoveFd(loop, watcher->fd);
+			}
+		}
+	}
+
+	FreeRemoved(loop);
+
+	return (was_error);
+}
+
+/****************************************************************************/
+
+/* to wake up a waiting loop.
+	can be called from any thread, and from a signal handler */
+void EVWake(evloop_t *loop)
+{
+	uint64_t one = 1;
+
+	/* checking parameters */
+	assert(NULL != loop);
+
+	if (0 > write(loop->wake.fd, &one, sizeof(one)))
+	{
+		return;
+	}
+}
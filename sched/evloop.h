@@ -0,0 +1,57 @@
+#ifndef EVLOOP_H
+
+#define EVLOOP_H
+
+#include <stddef.h>
+
+#include "schtime.h" /* sched_time_t */
+
+typedef struct evloop evloop_t;
+
+/* the events of a file descriptor */
+enum
+{
+	EV_IN = 1,
+	EV_OUT = 2,
+	EV_ERR = 4
+};
+
+/* the func of a file descriptor.
+	gets the fd, the events that happened and the user's arg.
+	returns -1 for failure, 0 - success and stop watching, 1 - keep watching */
+typedef int (*ev_func_t)(int fd, unsigned int events, void *arg);
+
+/************************Functions*************************************/
+
+/* the function creates a new event loop - an epoll instance, with a timerfd
+	for the deadline and an eventfd to wake it up.
+	returns the loop (or NULL if one of the creations failed) */
+evloop_t *EVCreate(void);
+
+/* to destroy an event loop (the fds of the user are not closed) */
+void EVDestroy(evloop_t *loop);
+
+/* to watch a file descriptor.
+	'func' is called from EVWait when one of 'events' happens.
+	returns 0 for success, and 1 for failure */
+int EVAddFd(evloop_t *loop, int fd, unsigned int events, ev_func_t func, void *arg);
+
+/* to stop watching a file descriptor (can be called from a fd func).
+	returns 0 for success, and 1 if the fd isn't watched */
+int EVRemoveFd(evloop_t *loop, int fd);
+
+/* to count how many file descriptors are watched */
+size_t EVCountFds(const evloop_t *loop);
+
+/* to wait until the absolute time 'deadline' (monotonic clock), until an
+	event of a watched fd, or until EVWake is called.
+	a negative deadline means no deadline.
+	the funcs of the fds that have events are called.
+	returns 0 for success, and 1 if one of the fd funcs failed */
+int EVWait(evloop_t *loop, sched_time_t deadline);
+
+/* to wake up a waiting loop.
+	can be called from any thread, and from a signal handler */
+void EVWake(evloop_t *loop);
+
+#endif /* EVLOOP_H */
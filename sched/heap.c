@@ -0,0 +1,446 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, realloc, free */
+
+#include "heap.h"
+
+#define HEAP_INIT_CAPACITY 16
+
+/* a batch bigger than 1/HEAP_REBUILD_RATIO of the heap is pushed by
+	building the heap again, which is cheaper than sifting every element */
+#define HEAP_REBUILD_RATIO 8
+
+struct heap
+{
+	void **arr;
+	size_t size;
+	size_t capacity;
+	size_t arity;
+	void *param;
+	is_before_t is_before;
+	heap_index_t index_func;
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+static int IsBefore(const heap_t *heap, size_t i, size_t j)
+{
+	return (heap->is_before(heap->arr[i], heap->arr[j], heap->param));
+}
+
+/****************************************************************************/
+
+/* to put data in a given index, and tell the data where it is */
+static void Set(heap_t *heap, size_t index, void *data)
+{
+	heap->arr[index] = data;
+
+	if (NULL != heap->index_func)
+	{
+		*heap->index_func(data) = index;
+	}
+}
+
+/****************************************************************************/
+
+static void Swap(heap_t *heap, size_t i, size_t j)
+{
+	void *temp = heap->arr[i];
+
+	Set(heap, i, heap->arr[j]);
+	Set(heap, j, temp);
+}
+
+/****************************************************************************/
+
+/* to move an element up until its parent is before it */
+static void SiftUp(heap_t *heap, size_t index)
+{
+	size_t parent = 0;
+
+	while (0 < index)
+	{
+		parent = (index - 1) / heap->arity;
+
+		if (0 == IsBefore(heap, index, parent))
+		{
+			break;
+		}
+
+		Swap(heap, index, parent);
+		index = parent;
+	}
+}
+
+/****************************************************************************/
+
+/* to move an element down until it's before all of its children */
+static void SiftDown(heap_t *heap, size_t index)
+{
+	size_t first_child = 0;
+	size_t last_child = 0;
+	size_t best = 0;
+	size_t child = 0;
+
+	while (1)
+	{
+		first_child = (index * heap->arity) + 1;
+		if (first_child >= heap->size)
+		{
+			break;
+		}
+
+		last_child = first_child + heap->arity;
+		if (last_child > heap->size)
+		{
+			last_child = heap->size;
+		}
+
+		/* to find the child that should be first */
+		best = first_child;
+		for (child = first_child + 1; child < last_child; ++child)
+		{
+			if (1 == IsBefore(heap, child, best))
+			{
+				best = child;
+			}
+		}
+
+		if (0 == IsBefore(heap, best, index))
+		{
+			break;
+		}
+
+		Swap(heap, index, best);
+		index = best;
+	}
+}
+
+/****************************************************************************/
+
+/* to find the index of a given data.
+	returns HEAP_NO_INDEX if it isn't in the heap */
+static size_t IndexOf(const heap_t *heap, void *data)
+{
+	size_t index = 0;
+
+	if (NULL != heap->index_func)
+	{
+		index = *heap->index_func(data);
+
+		return (((index < heap->size) && (data == heap->arr[index])) ?
+				index : HEAP_NO_INDEX);
+	}
+
+	for (index = 0; index < heap->size; ++index)
+	{
+		if (data == heap->arr[index])
+		{
+			return (index);
+		}
+	}
+
+	return (HEAP_NO_INDEX);
+}
+
+/****************************************************************************/
+
+/* to remove the element in a given index and fix the heap */
+static void *RemoveAt(heap_t *heap, size_t index)
+{
+	void *removed = heap->arr[index];
+
+	--heap->size;
+
+	/* the last element fills the hole, and goes up or down to its place */
+	if (index != heap->size)
+	{
+		Set(heap, index, heap->arr[heap->size]);
+		SiftDown(heap, index);
+		SiftUp(heap, index);
+	}
+
+	if (NULL != heap->index_func)
+	{
+		*heap->index_func(removed) = HEAP_NO_INDEX;
+	}
+
+	return (removed);
+}
+
+/****************************************************************************/
+
+/* the function creates a new d-ary heap, stored in a contiguous array.
+	'arity' is the number of children of every node (2 and above).
+	'index_func' can be NULL if the data doesn't keep its index
+	(then HeapUpdate and HeapRemoveData search for the data).
+	returns the heap (or NULL if one of the allocation failed) */
+heap_t *HeapCreate(is_before_t func, void *param, size_t arity,
+				   heap_index_t index_func)
+{
+	heap_t *new_heap = NULL;
+
+	/* checking parameters */
+	assert((NULL != func) && (2 <= arity));
+
+	new_heap = (heap_t *)malloc(sizeof(heap_t));
+	if (NULL == new_heap)
+	{
+		return (NULL);
+	}
+
+	new_heap->arr = (void **)malloc(HEAP_INIT_CAPACITY * sizeof(void *));
+	if (NULL == new_heap->arr)
+	{
+		free(new_heap); new_heap = NULL;
+
+		return (NULL);
+	}
+
+	new_heap->size = 0;
+	new_heap->capacity = HEAP_INIT_CAPACITY;
+	new_heap->arity = arity;
+	new_heap->param = param;
+	new_heap->is_before = func;
+	new_heap->index_func = index_func;
+
+	return (new_heap);
+}
+
+/****************************************************************************/
+
+/* to destroy a heap (the data itself is not freed) */
+void HeapDestroy(heap_t *heap)
+{
+	/* checking parameters */
+	assert(NULL != heap);
+
+	free(heap->arr); heap->arr = NULL;
+	free(heap); heap = NULL;
+}
+
+/****************************************************************************/
+
+/* to count how many elements are in the heap */
+size_t HeapSize(const heap_t *heap)
+{
+	/* checking parameters */
+	assert(NULL != heap);
+
+	return (heap->size);
+}
+
+/****************************************************************************/
+
+/* to check if the heap is empty.
+	returns 1 if empty, 0 - otherwise */
+int HeapIsEmpty(const heap_t *heap)
+{
+	/* checking parameters */
+	assert(NULL != heap);
+
+	return (0 == heap->size);
+}
+
+/****************************************************************************/
+
+/* to show the data in the top of the heap.
+	if the heap is empty - returns NULL */
+void *HeapPeek(const heap_t *heap)
+{
+	/* checking parameters */
+	assert(NULL != heap);
+
+	return ((0 == heap->size) ? NULL : heap->arr[0]);
+}
+
+/****************************************************************************/
+
+/* to make sure that the heap holds at least 'count' elements
+	without allocation.
+	returns 0 for success, and 1 for failure */
+int HeapReserve(heap_t *heap, size_t count)
+{
+	void **new_arr = NULL;
+
+	/* checking parameters */
+	assert(NULL != heap);
+
+	if (count <= heap->capacity)
+	{
+		return (0);
+	}
+
+	new_arr = (void **)realloc(heap->arr, count * sizeof(void *));
+	if (NULL == new_arr)
+	{
+		return (1);
+	}
+
+	heap->arr = new_arr;
+	heap->capacity = count;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to push a new element to the heap (O(log n)).
+	returns 0 for success, and 1 for failure */
+int HeapPush(heap_t *heap, void *data)
+{
+	void **new_arr = NULL;
+
+	/* checking parameters */
+	assert((NULL != heap) && (NULL != data));
+
+	/* to grow the array if it's full */
+	if (heap->size == heap->capacity)
+	{
+		new_arr = (void **)realloc(heap->arr,
+								   2 * heap->capacity * sizeof(void *));
+		if (NULL == new_arr)
+		{
+			return (1);
+		}
+
+		heap->arr = new_arr;
+		heap->capacity *= 2;
+	}
+
+	Set(heap, heap->size, data);
+	++heap->size;
+
+	SiftUp(heap, heap->size - 1);
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to push some elements at once.
+	a big batch is pushed by building the whole heap again (O(n)),
+	and a small one by sifting every element up (O(k log n)).
+	returns 0 for success, and 1 for failure (then nothing is pushed) */
+int HeapPushBatch(heap_t *heap, void **data, size_t count)
+{
+	size_t old_size = 0;
+	size_t i = 0;
+
+	/* checking parameters */
+	assert((NULL != heap) && ((NULL != data) || (0 == count)));
+
+	if ((heap->size + count > heap->capacity) &&
+		(1 == HeapReserve(heap, (heap->size + count > 2 * heap->capacity) ?
+								(heap->size + count) : (2 * heap->capacity))))
+	{
+		return (1);
+	}
+
+	old_size = heap->size;
+
+	for (i = 0; i < count; ++i)
+	{
+		assert(NULL != data[i]);
+		Set(heap, old_size + i, data[i]);
+	}
+
+	heap->size += count;
+
+	if ((2 <= heap->size) && (HEAP_REBUILD_RATIO * count >= heap->size))
+	{
+		/* every parent, from the last one up to the root */
+		for (i = ((heap->size - 2) / heap->arity) + 1; 0 < i; --i)
+		{
+			SiftDown(heap, i - 1);
+		}
+
+		return (0);
+	}
+
+	for (i = old_size; i < heap->size; ++i)
+	{
+		SiftUp(heap, i);
+	}
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to pop the top element of the heap (O(log n)).
+	returns the data of the popped element, or NULL if the heap is empty */
+void *HeapPop(heap_t *heap)
+{
+	/* checking parameters */
+	assert(NULL != heap);
+
+	if (0 == heap->size)
+	{
+		return (NULL);
+	}
+
+	return (RemoveAt(heap, 0));
+}
+
+/****************************************************************************/
+
+/* to remove the first element that matches the find func.
+	returns the data of the removed element, or NULL if didn't find */
+void *HeapRemove(heap_t *heap, find_func_t func, void *param)
+{
+	size_t i = 0;
+
+	/* checking parameters */
+	assert((NULL != heap) && (NULL != func));
+
+	for (i = 0; i < heap->size; ++i)
+	{
+		if (1 == func(heap->arr[i], param))
+		{
+			return (RemoveAt(heap, i));
+		}
+	}
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+/* to move an element to its place after its order changed
+	(O(log n) with an index func, O(n) without) */
+void HeapUpdate(heap_t *heap, void *data)
+{
+	size_t index = 0;
+
+	/* checking parameters */
+	assert((NULL != heap) && (NULL != data));
+
+	index = IndexOf(heap, data);
+	assert(HEAP_NO_INDEX != index);
+
+	SiftDown(heap, index);
+	SiftUp(heap, index);
+}
+
+/****************************************************************************/
+
+/* to remove a given element from the heap
+	(O(log n) with an index func, O(n) without).
+	returns the data, or NULL if it isn't in the heap */
+void *HeapRemoveData(heap_t *heap, void *data)
+{
+	size_t index = 0;
+
+	/* checking parameters */
+	assert((NULL != heap) && (NULL != data));
+
+	index = IndexOf(heap, data);
+	if (HEAP_NO_INDEX == index)
+	{
+		return (NULL);
+	}
+
+	return (RemoveAt(heap, index));
+}
@@ -0,0 +1,75 @@
+#ifndef HEAP_H
+
+#define HEAP_H
+
+#include <stddef.h>
+
+#include "sortedlist.h" /* is_before_t, find_func_t */
+
+#define HEAP_DEFAULT_ARITY 4
+#define HEAP_NO_INDEX ((size_t)-1)
+
+typedef struct heap heap_t;
+
+/* to get the place inside the data that the heap keeps its index in.
+	the heap updates it on every move, and sets it to HEAP_NO_INDEX
+	when the data leaves the heap */
+typedef size_t *(*heap_index_t)(void *data);
+
+/************************Functions*************************************/
+
+/* the function creates a new d-ary heap, stored in a contiguous array.
+	'arity' is the number of children of every node (2 and above).
+	'index_func' can be NULL if the data doesn't keep its index
+	(then HeapUpdate and HeapRemoveData search for the data).
+	returns the heap (or NULL if one of the allocation failed) */
+heap_t *HeapCreate(is_before_t func, void *param, size_t arity,
+				   heap_index_t index_func);
+
+/* to destroy a heap (the data itself is not freed) */
+void HeapDestroy(heap_t *heap);
+
+/* to count how many elements are in the heap */
+size_t HeapSize(const heap_t *heap);
+
+/* to check if the heap is empty.
+	returns 1 if empty, 0 - otherwise */
+int HeapIsEmpty(const heap_t *heap);
+
+/* to show the data in the top of the heap.
+	if the heap is empty - returns NULL */
+void *HeapPeek(const heap_t *heap);
+
+/* to make sure that the heap holds at least 'count' elements
+	without allocation.
+	returns 0 for success, and 1 for failure */
+int HeapReserve(heap_t *heap, size_t count);
+
+/* to push a new element to the heap (O(log n)).
+	returns 0 for success, and 1 for failure */
+int HeapPush(heap_t *heap, void *data);
+
+/* to push some elements at once.
+	a big batch is pushed by building the whole heap again (O(n)),
+	and a small one by sifting every element up (O(k log n)).
+	returns 0 for success, and 1 for failure (then nothing is pushed) */
+int HeapPushBatch(heap_t *heap, void **data, size_t count);
+
+/* to pop the top element of the heap (O(log n)).
+	returns the data of the popped element, or NULL if the heap is empty */
+void *HeapPop(heap_t *heap);
+
+/* to remove the first element that matches the find func.
+	returns the data of the removed element, or NULL if didn't find */
+void *HeapRemove(heap_t *heap, find_func_t func, void *param);
+
+/* to move an element to its place after its order changed
+	(O(log n) with an index func, O(n) without) */
+void HeapUpdate(heap_t *heap, void *data);
+
+/* to remove a given element from the heap
+	(O(log n) with an index func, O(n) without).
+	returns the data, or NULL if it isn't in the heap */
+void *HeapRemoveData(heap_t *heap, void *data);
+
+#endif /* HEAP_H */
@@ -0,0 +1,188 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memset */
+
+#include "hist.h"
+
+/* every power of two is split to 2^HIST_SUB_BITS linear buckets */
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+
+/* the values below HIST_SUB have a bucket each, and every power of two
+	from HIST_SUB up to the top bit of sched_time_t has HIST_SUB buckets */
+#define HIST_BUCKETS ((63 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+struct hist
+{
+	size_t count;
+	sched_time_t max;
+	size_t buckets[HIST_BUCKETS];
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+/* to find the bucket of a value (not negative) */
+static size_t BucketOf(sched_time_t value)
+{
+	uint64_t bits = (uint64_t)value;
+	int shift = 0;
+
+	if (HIST_SUB > bits)
+	{
+		return ((size_t)bits);
+	}
+
+	/* the top bit says the power of two, and the next HIST_SUB_BITS bits
+		say the linear bucket inside it */
+	shift = 63 - __builtin_clzll(bits) - HIST_SUB_BITS;
+
+	return ((size_t)(shift + 1) * HIST_SUB +
+			(size_t)((bits >> shift) - HIST_SUB));
+}
+
+/****************************************************************************/
+
+/* to find the biggest value that goes to a bucket */
+static sched_time_t TopOf(size_t bucket)
+{
+	int shift = 0;
+
+	if (HIST_SUB > bucket)
+	{
+		return ((sched_time_t)bucket);
+	}
+
+	shift = (int)(bucket / HIST_SUB) - 1;
+
+	return ((sched_time_t)((((uint64_t)(HIST_SUB + (bucket % HIST_SUB)) + 1) <<
+							shift) - 1));
+}
+
+/****************************************************************************/
+
+/* the function creates a new log linear histogram of times.
+	every power of two is split to 16 linear buckets, so a value is kept
+	with an error of up to 1/16 (6%), from 1 nanosecond to centuries,
+	in a fixed array - recording never allocates.
+	returns the histogram (or NULL if the allocation failed) */
+hist_t *HistCreate(void)
+{
+	hist_t *new_hist = (hist_t *)malloc(sizeof(hist_t));
+	if (NULL == new_hist)
+	{
+		return (NULL);
+	}
+
+	HistClear(new_hist);
+
+	return (new_hist);
+}
+
+/****************************************************************************/
+
+/* to destroy a histogram */
+void HistDestroy(hist_t *hist)
+{
+	/* checking parameters */
+	assert(NULL != hist);
+
+	free(hist); hist = NULL;
+}
+
+/****************************************************************************/
+
+/* to record a value (a negative value is recorded as 0) - O(1) */
+void HistRecord(hist_t *hist, sched_time_t value)
+{
+	/* checking parameters */
+	assert(NULL != hist);
+
+	if (0 > value)
+	{
+		value = 0;
+	}
+
+	++hist->buckets[BucketOf(value)];
+	++hist->count;
+
+	if (value > hist->max)
+	{
+		hist->max = value;
+	}
+}
+
+/****************************************************************************/
+
+/* to count the values that were recorded */
+size_t HistCount(const hist_t *hist)
+{
+	/* checking parameters */
+	assert(NULL != hist);
+
+	return (hist->count);
+}
+
+/****************************************************************************/
+
+/* to get the biggest value that was recorded (0 if there is none) */
+sched_time_t HistMax(const hist_t *hist)
+{
+	/* checking parameters */
+	assert(NULL != hist);
+
+	return (hist->max);
+}
+
+/****************************************************************************/
+
+/* to get the value that 'percent' (0 to 100) of the values are up to.
+	returns the top of its bucket (not more than the max),
+	or 0 if there is no value */
+sched_time_t HistPercentile(const hist_t *hist, double percent)
+{
+	size_t rank = 0;
+	size_t seen = 0;
+	size_t i = 0;
+
+	/* checking parameters */
+	assert((NULL != hist) && (0 <= percent) && (100 >= percent));
+
+	if (0 == hist->count)
+	{
+		return (0);
+	}
+
+	/* the place of the value by the order, from 1 (rounded up) */
+	rank = (size_t)((percent / 100) * (double)hist->count);
+	if ((0 == rank) || ((double)rank < (percent / 100) * (double)hist->count))
+	{
+		++rank;
+	}
+
+	for (i = 0; i < HIST_BUCKETS; ++i)
+	{
+		seen += hist->buckets[i];
+
+		if (seen >= rank)
+		{
+			break;
+		}
+	}
+
+	return ((TopOf(i) < hist->max) ? TopOf(i) : hist->max);
+}
+
+/****************************************************************************/
+
+/* to forget all the values */
+void HistClear(hist_t *hist)
+{
+	/* checking parameters */
+	assert(NULL != hist);
+
+	memset(hist->buckets, 0, sizeof(hist->buckets));
+	hist->count = 0;
+	hist->max = 0;
+}
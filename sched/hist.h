@@ -0,0 +1,40 @@
+#ifndef HIST_H
+
+#define HIST_H
+
+#include <stddef.h>
+
+#include "schtime.h" /* sched_time_t */
+
+typedef struct hist hist_t;
+
+/************************Functions*************************************/
+
+/* the function creates a new log linear histogram of times.
+	every power of two is split to 16 linear buckets, so a value is kept
+	with an error of up to 1/16 (6%), from 1 nanosecond to centuries,
+	in a fixed array - recording never allocates.
+	returns the histogram (or NULL if the allocation failed) */
+hist_t *HistCreate(void);
+
+/* to destroy a histogram */
+void HistDestroy(hist_t *hist);
+
+/* to record a value (a negative value is recorded as 0) - O(1) */
+void HistRecord(hist_t *hist, sched_time_t value);
+
+/* to count the values that were recorded */
+size_t HistCount(const hist_t *hist);
+
+/* to get the biggest value that was recorded (0 if there is none) */
+sched_time_t HistMax(const hist_t *hist);
+
+/* to get the value that 'percent' (0 to 100) of the values are up to.
+	returns the top of its bucket (not more than the max),
+	or 0 if there is no value */
+sched_time_t HistPercentile(const hist_t *hist, double percent);
+
+/* to forget all the values */
+void HistClear(hist_t *hist);
+
+#endif /* HIST_H */
@@ -0,0 +1,98 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, free */
+
+#include "mpscq.h"
+
+/* the queue is a stack that the producers push to with a compare and swap.
+	the consumer takes the whole stack at once and reverses it, so a node
+	never leaves alone and there is no ABA problem */
+struct mpscq
+{
+	mpsc_node_t *top;
+};
+
+/****************************************************************************/
+
+/* the function creates a new lock free queue, that many threads push to
+	and one thread takes from.
+	returns the queue (or NULL if the allocation failed) */
+mpscq_t *MPSCCreate(void)
+{
+	mpscq_t *new_queue = (mpscq_t *)malloc(sizeof(mpscq_t));
+	if (NULL == new_queue)
+	{
+		return (NULL);
+	}
+
+	new_queue->top = NULL;
+
+	return (new_queue);
+}
+
+/****************************************************************************/
+
+/* to destroy a queue (the nodes that are still in it are not freed) */
+void MPSCDestroy(mpscq_t *queue)
+{
+	/* checking parameters */
+	assert(NULL != queue);
+
+	free(queue); queue = NULL;
+}
+
+/****************************************************************************/
+
+/* to push a node to the queue (lock free - one compare and swap,
+	that is tried again only if another thread pushed at the same time).
+	can be called from any thread, and from a signal handler.
+	returns 1 if the queue was empty, 0 - otherwise */
+int MPSCPush(mpscq_t *queue, mpsc_node_t *node)
+{
+	mpsc_node_t *top = NULL;
+	mpsc_node_t *seen = NULL;
+
+	/* checking parameters */
+	assert((NULL != queue) && (NULL != node));
+
+	/* the first guess is an empty queue, and a failed swap
+		gives the top that is really there */
+	do
+	{
+		top = seen;
+		node->next = top;
+		seen = __sync_val_compare_and_swap(&queue->top, top, node);
+	}
+	while (seen != top);
+
+	return (NULL == top);
+}
+
+/****************************************************************************/
+
+/* to take all the nodes of the queue at once (one atomic exchange).
+	only one thread can take.
+	returns the first node that was pushed (the next ones follow it by
+	their 'next', by the order of the pushes), or NULL if the queue is empty */
+mpsc_node_t *MPSCTakeAll(mpscq_t *queue)
+{
+	mpsc_node_t *node = NULL;
+	mpsc_node_t *next = NULL;
+	mpsc_node_t *first = NULL;
+
+	/* checking parameters */
+	assert(NULL != queue);
+
+	/* the swap of the push releases the node, and this one acquires it */
+	node = __sync_lock_test_and_set(&queue->top, NULL);
+
+	/* the stack is from the last push to the first one */
+	while (NULL != node)
+	{
+		next = node->next;
+		node->next = first;
+		first = node;
+		node = next;
+	}
+
+	return (first);
+}
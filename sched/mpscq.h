@@ -0,0 +1,40 @@
+#ifndef MPSCQ_H
+
+#define MPSCQ_H
+
+#include <stddef.h>
+
+typedef struct mpscq mpscq_t;
+typedef struct mpsc_node mpsc_node_t;
+
+/* the node of the queue lives inside the user's struct (intrusive),
+	so pushing never allocates.
+	the field is for the queue only - don't touch it */
+struct mpsc_node
+{
+	mpsc_node_t *next;
+};
+
+/************************Functions*************************************/
+
+/* the function creates a new lock free queue, that many threads push to
+	and one thread takes from.
+	returns the queue (or NULL if the allocation failed) */
+mpscq_t *MPSCCreate(void);
+
+/* to destroy a queue (the nodes that are still in it are not freed) */
+void MPSCDestroy(mpscq_t *queue);
+
+/* to push a node to the queue (lock free - one compare and swap,
+	that is tried again only if another thread pushed at the same time).
+	can be called from any thread, and from a signal handler.
+	returns 1 if the queue was empty, 0 - otherwise */
+int MPSCPush(mpscq_t *queue, mpsc_node_t *node);
+
+/* to take all the nodes of the queue at once (one atomic exchange).
+	only one thread can take.
+	returns the first node that was pushed (the next ones follow it by
+	their 'next', by the order of the pushes), or NULL if the queue is empty */
+mpsc_node_t *MPSCTakeAll(mpscq_t *queue);
+
+#endif /* MPSCQ_H */
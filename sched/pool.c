@@ -0,0 +1,203 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, free */
+
+#include "pool.h"
+
+#define POOL_MIN_GROW 16
+
+/* every object and chunk header is aligned to the strictest basic type */
+typedef union pool_align
+{
+	long l;
+	double d;
+	void *p;
+} pool_align_t;
+
+/* a free object keeps the link to the next free one inside itself */
+typedef struct pool_free
+{
+	struct pool_free *next;
+} pool_free_t;
+
+typedef struct pool_chunk
+{
+	struct pool_chunk *next;
+} pool_chunk_t;
+
+struct pool
+{
+	pool_free_t *free_list;
+	pool_chunk_t *chunks;
+	size_t obj_size;
+	size_t count_free;
+	size_t count_all;
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+/* to round a size up to a multiple of the alignment */
+static size_t AlignUp(size_t size)
+{
+	return (((size + sizeof(pool_align_t) - 1) / sizeof(pool_align_t)) *
+			sizeof(pool_align_t));
+}
+
+/****************************************************************************/
+
+/* to allocate a chunk of 'count' objects and link them to the free list.
+	returns 0 for success, and 1 for failure */
+static int Grow(pool_t *pool, size_t count)
+{
+	pool_chunk_t *chunk = NULL;
+	char *obj = NULL;
+	size_t i = 0;
+
+	chunk = (pool_chunk_t *)malloc(AlignUp(sizeof(pool_chunk_t)) +
+								   (count * pool->obj_size));
+	if (NULL == chunk)
+	{
+		return (1);
+	}
+
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+
+	obj = (char *)chunk + AlignUp(sizeof(pool_chunk_t));
+	for (i = 0; i < count; ++i, obj += pool->obj_size)
+	{
+		PoolFree(pool, obj);
+	}
+
+	pool->count_all += count;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* the function creates a new pool of fixed size objects.
+	'count' objects are allocated at once (can be 0), and the pool grows
+	by chunks only when all of them are in use.
+	returns the pool (or NULL if one of the allocation failed) */
+pool_t *PoolCreate(size_t obj_size, size_t count)
+{
+	pool_t *new_pool = NULL;
+
+	/* checking parameters */
+	assert(0 < obj_size);
+
+	new_pool = (pool_t *)malloc(sizeof(pool_t));
+	if (NULL == new_pool)
+	{
+		return (NULL);
+	}
+
+	new_pool->free_list = NULL;
+	new_pool->chunks = NULL;
+	new_pool->obj_size = AlignUp((obj_size < sizeof(pool_free_t)) ?
+								 sizeof(pool_free_t) : obj_size);
+	new_pool->count_free = 0;
+	new_pool->count_all = 0;
+
+	if ((0 < count) && (1 == Grow(new_pool, count)))
+	{
+		free(new_pool); new_pool = NULL;
+
+		return (NULL);
+	}
+
+	return (new_pool);
+}
+
+/****************************************************************************/
+
+/* to destroy a pool, with all the objects that it allocated */
+void PoolDestroy(pool_t *pool)
+{
+	pool_chunk_t *next = NULL;
+
+	/* checking parameters */
+	assert(NULL != pool);
+
+	while (NULL != pool->chunks)
+	{
+		next = pool->chunks->next;
+		free(pool->chunks);
+		pool->chunks = next;
+	}
+
+	free(pool); pool = NULL;
+}
+
+/****************************************************************************/
+
+/* to make sure that at least 'count' objects can be taken
+	from the pool without allocation.
+	returns 0 for success, and 1 for failure */
+int PoolReserve(pool_t *pool, size_t count)
+{
+	/* checking parameters */
+	assert(NULL != pool);
+
+	if (count <= pool->count_free)
+	{
+		return (0);
+	}
+
+	return (Grow(pool, count - pool->count_free));
+}
+
+/****************************************************************************/
+
+/* to take an object from the pool (O(1)).
+	allocates a new chunk only if the pool is empty.
+	returns the object, or NULL if the allocation failed */
+void *PoolAlloc(pool_t *pool)
+{
+	pool_free_t *obj = NULL;
+
+	/* checking parameters */
+	assert(NULL != pool);
+
+	/* the pool doubles, so the allocations are rare */
+	if ((NULL == pool->free_list) &&
+		(1 == Grow(pool, (POOL_MIN_GROW > pool->count_all) ?
+						 POOL_MIN_GROW : pool->count_all)))
+	{
+		return (NULL);
+	}
+
+	obj = pool->free_list;
+	pool->free_list = obj->next;
+	--pool->count_free;
+
+	return (obj);
+}
+
+/****************************************************************************/
+
+/* to give an object back to the pool (O(1)) */
+void PoolFree(pool_t *pool, void *obj)
+{
+	pool_free_t *to_free = (pool_free_t *)obj;
+
+	/* checking parameters */
+	assert((NULL != pool) && (NULL != obj));
+
+	to_free->next = pool->free_list;
+	pool->free_list = to_free;
+	++pool->count_free;
+}
+
+/****************************************************************************/
+
+/* to count how many objects can be taken without allocation */
+size_t PoolCountFree(const pool_t *pool)
+{
+	/* checking parameters */
+	assert(NULL != pool);
+
+	return (pool->count_free);
+}
@@ -0,0 +1,36 @@
+#ifndef POOL_H
+
+#define POOL_H
+
+#include <stddef.h>
+
+typedef struct pool pool_t;
+
+/************************Functions*************************************/
+
+/* the function creates a new pool of fixed size objects.
+	'count' objects are allocated at once (can be 0), and the pool grows
+	by chunks only when all of them are in use.
+	returns the pool (or NULL if one of the allocation failed) */
+pool_t *PoolCreate(size_t obj_size, size_t count);
+
+/* to destroy a pool, with all the objects that it allocated */
+void PoolDestroy(pool_t *pool);
+
+/* to make sure that at least 'count' objects can be taken
+	from the pool without allocation.
+	returns 0 for success, and 1 for failure */
+int PoolReserve(pool_t *pool, size_t count);
+
+/* to take an object from the pool (O(1)).
+	allocates a new chunk only if the pool is empty.
+	returns the object, or NULL if the allocation failed */
+void *PoolAlloc(pool_t *pool);
+
+/* to give an object back to the pool (O(1)) */
+void PoolFree(pool_t *pool, void *obj);
+
+/* to count how many objects can be taken without allocation */
+size_t PoolCountFree(const pool_t *pool);
+
+#endif /* POOL_H */
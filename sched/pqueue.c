@@ -1,21 +1,48 @@
 #include <assert.h> /* assert */
 #include <stdlib.h> /* malloc, free */
 
+#include "pool.h"
 #include "dlist.h"
 #include "sortedlist.h"
+#include "heap.h"
 #include "pqueue.h"
 
 struct pqueue
 {
+	pq_type_t type;
 	sdlist_t *q_head;
+	pool_t *node_pool;
+	heap_t *heap;
 };
 
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+static int IsSameData(const void *data, void *param)
+{
+	return (data == param);
+}
+
+/****************************************************************************/
+
+/* to find the iterator of a given data in the sdlist.
+	returns the end if it isn't there */
+static sdlist_info_t FindData(const pqueue_t *my_pqueue, void *data)
+{
+	return (SortedListFind(SortedListBegin(my_pqueue->q_head),
+						   SortedListEnd(my_pqueue->q_head), &IsSameData, data));
+}
+
 /****************************************************************************/
 
 /* the function creates a new pqueue.
-    the function creates also a node that is a sdlist.
+    the function creates also the data structure that is selected by 'type'
+    (a sdlist or a heap).
+    'index_func' can be NULL if the data doesn't keep its index in the heap.
     returns the queue (or NULL if one of the allocation failed) */
-pqueue_t *PQCreate(is_before_t func, void *param)
+pqueue_t *PQCreate(is_before_t func, void *param, pq_type_t type,
+				   pq_index_t index_func)
 {
 	pqueue_t *new_pqueue = NULL;
 
@@ -27,16 +54,39 @@ pqueue_t *PQCreate(is_before_t func, void *param)
 	{
 		return (NULL);
 	}
-	
-	/* to create the node dlist */
-	new_pqueue->q_head = SortedListCreate(func, param);
-	if (NULL == new_pqueue->q_head)
+
+	new_pqueue->type = type;
+	new_pqueue->q_head = NULL;
+	new_pqueue->node_pool = NULL;
+	new_pqueue->heap = NULL;
+
+	if (PQ_HEAP == type)
+	{
+		new_pqueue->heap = HeapCreate(func, param, HEAP_DEFAULT_ARITY,
+												index_func);
+	}
+	else
+	{
+		/* the nodes of the list come from a pool of the pqueue */
+		new_pqueue->node_pool = PoolCreate(DLNodeSize(), 0);
+		if (NULL != new_pqueue->node_pool)
+		{
+			new_pqueue->q_head = SortedListCreateWithPool(func, param,
+														  new_pqueue->node_pool);
+			if (NULL == new_pqueue->q_head)
+			{
+				PoolDestroy(new_pqueue->node_pool); new_pqueue->node_pool = NULL;
+			}
+		}
+	}
+
+	if ((NULL == new_pqueue->q_head) && (NULL == new_pqueue->heap))
 	{
 		free(new_pqueue); new_pqueue = NULL;
-		
+
 		return (NULL);
 	}
-	
+
 	return (new_pqueue);
 }
 
@@ -47,21 +97,34 @@ void PQDestroy(pqueue_t *to_destroy)
 {
     /* checking parameters */
     assert(NULL != to_destroy);
-    
-    SortedListDestroy(to_destroy->q_head);
-    
+
+	if (PQ_HEAP == to_destroy->type)
+	{
+		HeapDestroy(to_destroy->heap);
+	}
+	else
+	{
+		SortedListDestroy(to_destroy->q_head);
+		PoolDestroy(to_destroy->node_pool);
+	}
+
 	free(to_destroy); to_destroy = NULL;
 }
 
 /****************************************************************************/
 
-/* to show the data in the begin iterator of the pqueue 
+/* to show the data in the begin iterator of the pqueue
 	if the pqueue if empty - returns NULL */
 void *PQPeek(const pqueue_t *my_pqueue)
 {
     /* checking parameters */
     assert(NULL != my_pqueue);
 
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapPeek(my_pqueue->heap));
+	}
+
 	return (SortedListGetData(SortedListBegin(my_pqueue->q_head)));
 }
 
@@ -73,6 +136,11 @@ size_t PQSize(const pqueue_t *my_pqueue)
     /* checking parameters */
     assert(NULL != my_pqueue);
 
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapSize(my_pqueue->heap));
+	}
+
 	return (SortedListSize(my_pqueue->q_head));
 }
 
@@ -85,6 +153,11 @@ int PQIsEmpty(const pqueue_t *my_pqueue)
     /* checking parameters */
     assert(NULL != my_pqueue);
 
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapIsEmpty(my_pqueue->heap));
+	}
+
 	return (SortedListIsEmpty(my_pqueue->q_head));
 }
 
@@ -104,6 +177,28 @@ void PQClear(pqueue_t *pqueue_to_clear)
 
 /****************************************************************************/
 
+/* to make sure that the pqueue holds at least 'count' elements
+	without allocation.
+	returns 0 for success, and 1 for failure */
+int PQReserve(pqueue_t *my_pqueue, size_t count)
+{
+	size_t size = 0;
+
+    /* checking parameters */
+    assert(NULL != my_pqueue);
+
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapReserve(my_pqueue->heap, count));
+	}
+
+	size = SortedListSize(my_pqueue->q_head);
+
+	return ((count <= size) ? 0 : PoolReserve(my_pqueue->node_pool, count - size));
+}
+
+/****************************************************************************/
+
 /* to insert a new iterator to its place in the pqueue (by the order).
 	returns 0 for success, and 1 for failure  */
 int PQEnqueue(pqueue_t *my_pqueue, void *data)
@@ -113,6 +208,11 @@ int PQEnqueue(pqueue_t *my_pqueue, void *data)
     /* checking parameters */
     assert((NULL != my_pqueue) && (NULL != data));
 
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapPush(my_pqueue->heap, data));
+	}
+
 	/* inserting the iterator */
 	inserted = SortedListInsert(my_pqueue->q_head, data);
 
@@ -122,12 +222,44 @@ int PQEnqueue(pqueue_t *my_pqueue, void *data)
 
 /****************************************************************************/
 
+/* to insert some elements at once (the order of 'data' can change).
+	a heap is built again for a big batch, and a list merges the sorted
+	batch in one pass.
+	returns 0 for success, and 1 for failure (then nothing is inserted) */
+int PQEnqueueBatch(pqueue_t *my_pqueue, void **data, size_t count)
+{
+    /* checking parameters */
+    assert((NULL != my_pqueue) && ((NULL != data) || (0 == count)));
+
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapPushBatch(my_pqueue->heap, data, count));
+	}
+
+	/* with the nodes in the pool, the merge can't fail in the middle */
+	if (1 == PoolReserve(my_pqueue->node_pool, count))
+	{
+		return (1);
+	}
+
+	return (SortedListInsertBatch(my_pqueue->q_head, data, count));
+}
+
+/****************************************************************************/
+
 /* to pop the first element in the pqueue */
 void PQDequeue(pqueue_t *my_pqueue)
 {
     /* checking parameters */
     assert(NULL != my_pqueue);
 
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		HeapPop(my_pqueue->heap);
+
+		return;
+	}
+
 	SortedListPopFront(my_pqueue->q_head);
 }
 
@@ -139,20 +271,79 @@ void PQDequeue(pqueue_t *my_pqueue)
 void *PQErase(pqueue_t *my_pqueue, find_func_t func, void *param)
 {
 	sdlist_info_t to_erase = {NULL};
-	
+	void *data = NULL;
+
     /* checking parameters */
     assert((NULL != my_pqueue) && (NULL != func) && (NULL != param));
-	
+
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapRemove(my_pqueue->heap, func, param));
+	}
+
 	to_erase = SortedListFind(SortedListBegin(my_pqueue->q_head),
 											SortedListEnd(my_pqueue->q_head),
 											func, param);
-	
+
+	if (1 == SortedListIsSameIterator(to_erase, SortedListEnd(my_pqueue->q_head)))
+	{
+		return (NULL);
+	}
+
+	data = SortedListGetData(to_erase);
+	SortedListErase(to_erase);
+
+	return (data);
+}
+
+/****************************************************************************/
+
+/* to move a given element to its place after its order changed,
+	without any allocation (O(log n) in a heap with an index func) */
+void PQUpdate(pqueue_t *my_pqueue, void *data)
+{
+	sdlist_info_t to_move = {NULL};
+
+    /* checking parameters */
+    assert((NULL != my_pqueue) && (NULL != data));
+
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		HeapUpdate(my_pqueue->heap, data);
+
+		return;
+	}
+
+	to_move = FindData(my_pqueue, data);
+	assert(0 == SortedListIsSameIterator(to_move, SortedListEnd(my_pqueue->q_head)));
+
+	SortedListRelocate(my_pqueue->q_head, to_move);
+}
+
+/****************************************************************************/
+
+/* to erase a given element from the pqueue
+	(O(log n) in a heap with an index func).
+	returns the data, or NULL if it isn't in the pqueue */
+void *PQEraseData(pqueue_t *my_pqueue, void *data)
+{
+	sdlist_info_t to_erase = {NULL};
+
+    /* checking parameters */
+    assert((NULL != my_pqueue) && (NULL != data));
+
+	if (PQ_HEAP == my_pqueue->type)
+	{
+		return (HeapRemoveData(my_pqueue->heap, data));
+	}
+
+	to_erase = FindData(my_pqueue, data);
 	if (1 == SortedListIsSameIterator(to_erase, SortedListEnd(my_pqueue->q_head)))
 	{
 		return (NULL);
 	}
-	
+
 	SortedListErase(to_erase);
 
-	return (param);
+	return (data);
 }
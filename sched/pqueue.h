@@ -5,12 +5,26 @@
 
 typedef struct pqueue pqueue_t;
 
+/* the data structure behind the pqueue */
+typedef enum
+{
+	PQ_SORTED_LIST,		/* O(n) enqueue, O(1) dequeue */
+	PQ_HEAP				/* d-ary heap - O(log n) enqueue and dequeue */
+} pq_type_t;
+
+/* to get the place inside the data that the heap keeps its index in
+	(so the data can be updated or erased without a search) */
+typedef size_t *(*pq_index_t)(void *data);
+
 /************************Functions*************************************/
 
 /* the function creates a new pqueue.
-    the function creates also a node that is a sdlist.
+    the function creates also the data structure that is selected by 'type'
+    (a sdlist or a heap).
+    'index_func' can be NULL if the data doesn't keep its index in the heap.
     returns the queue (or NULL if one of the allocation failed) */
-pqueue_t *PQCreate(is_before_t func, void *param);
+pqueue_t *PQCreate(is_before_t func, void *param, pq_type_t type,
+				   pq_index_t index_func);
 
 /* to destroy a queue */
 void PQDestroy(pqueue_t *to_destroy);
@@ -29,14 +43,34 @@ int PQIsEmpty(const pqueue_t *my_pqueue);
 /* to clear all the iterators in the pqueue */
 void PQClear(pqueue_t *pqueue_to_clear);
 
+/* to make sure that the pqueue holds at least 'count' elements
+	without allocation.
+	returns 0 for success, and 1 for failure */
+int PQReserve(pqueue_t *my_pqueue, size_t count);
+
 /* to insert a new iterator to its place in the pqueue (by the order).
-	returns for success, and 1 for failure  */
+	returns 0 for success, and 1 for failure  */
 int PQEnqueue(pqueue_t *my_pqueue, void *data);
 
+/* to insert some elements at once (the order of 'data' can change).
+	a heap is built again for a big batch, and a list merges the sorted
+	batch in one pass.
+	returns 0 for success, and 1 for failure (then nothing is inserted) */
+int PQEnqueueBatch(pqueue_t *my_pqueue, void **data, size_t count);
+
 /* to pop the first element in the pqueue */
 void PQDequeue(pqueue_t *my_pqueue);
 
 /* returns the data of the erased element */
 void *PQErase(pqueue_t *my_pqueue, find_func_t func, void *param);
 
+/* to move a given element to its place after its order changed,
+	without any allocation (O(log n) in a heap with an index func) */
+void PQUpdate(pqueue_t *my_pqueue, void *data);
+
+/* to erase a given element from the pqueue
+	(O(log n) in a heap with an index func).
+	returns the data, or NULL if it isn't in the pqueue */
+void *PQEraseData(pqueue_t *my_pqueue, void *data);
+
 #endif /* PQUEUE_H */
@@ -1,55 +1,1157 @@
 #include <stdlib.h> /* malloc, free, size_t */
+#include <string.h> /* memcpy */
 #include <assert.h> /* assert */
-#include <time.h>
+#include <pthread.h> /* pthread_self, pthread_equal */
 
+#include "pool.h"
+#include "hist.h"
+#include "mpscq.h"
+#include "uidmap.h"
 #include "pqueue.h"
+#include "twheel.h"
+#include "schtime.h"
+#include "evloop.h"
+#include "wpool.h"
 #include "schtask.h"
 #include "sched.h"
 
+/* the most tasks that are taken out of the store in one wake up */
+#define SCH_BATCH_MAX 64
+
+/* the requests that other threads send to the thread of SCHRun */
+typedef enum
+{
+	SCH_CMD_ADD,
+	SCH_CMD_REMOVE,
+	SCH_CMD_MOVE,
+	SCH_CMD_ADD_FD,
+	SCH_CMD_REMOVE_FD
+} sch_cmd_type_t;
+
+typedef struct sch_cmd
+{
+	mpsc_node_t node;
+	sch_cmd_type_t type;
+	task_t **tasks;			/* ADD - the new tasks */
+	size_t count;
+	task_t *task;			/* ADD of one task - 'tasks' points to it */
+	uid_type uid;			/* REMOVE and MOVE */
+	sched_time_t interval;	/* MOVE */
+	sched_time_t deadline;
+	int is_interval;
+	int fd;					/* ADD_FD and REMOVE_FD */
+	unsigned int events;	/* ADD_FD */
+	ev_func_t fd_func;
+	void *arg;
+} sch_cmd_t;
+
+/* the most expensive tasks that were found so far, by their cpu time */
+typedef struct sch_top
+{
+	sched_task_cost_t *costs;
+	size_t count;
+	size_t max;
+} sch_top_t;
+
 struct sched
 {
-	pqueue_t *pq;
-    int to_exit;
-};
+	sched_backend_t backend;
+	pqueue_t *pq;
+	twheel_t *wheel;
+	sched_time_t wheel_tick;
+	const sched_clock_t *clock;
+	evloop_t *loop;
+	pool_t *task_pool;
+	uidmap_t *tasks;
+	task_t *batch[SCH_BATCH_MAX];
+	size_t batch_size;		/* the tasks that were due in this wake up */
+	size_t batch_next;		/* the next task of the batch to run */
+	size_t batch_kept;		/* the tasks that ran and wait to go back */
+	wpool_t *workers;
+	size_t in_flight;		/* the tasks that were given to the workers */
+	mpscq_t *commands;		/* the requests of the other threads */
+	pthread_t owner;		/* the thread that created the scheduler */
+	int is_in_run;			/* atomic */
+	pthread_t run_thread;
+	int to_exit;			/* atomic */
+	hist_t *lateness;		/* the start of every run after its time */
+	hist_t *run_time;		/* how long every run took */
+	size_t runs;			/* the runs since the stats were reset */
+	size_t missed;			/* the runs that the catch up policies dropped */
+	sched_time_t stats_since;
+};
+
+/**************************************************************************/
+/* 			                Help Functions                                */
+/**************************************************************************/
+
+static sched_time_t Now(const sched_t *sched)
+{
+	return (SCHClockNow(sched->clock));
+}
+
+/**************************************************************************/
+
+/* to check if the clock of the scheduler is virtual.
+	returns 1 if it is, 0 - otherwise */
+static int IsVirtual(const sched_t *sched)
+{
+	return ((NULL != sched->clock) && (NULL != sched->clock->advance));
+}
+
+/**************************************************************************/
+
+static void DestroyWheelNode(tw_node_t *node)
+{
+	SCHTaskDestroy(SCHTaskFromWheelNode(node));
+}
+
+/**************************************************************************/
+
+/* to choose the tick of a task in the wheel, between the tick of its next
+	run time and the tick of its deadline.
+	the roundest tick in the window is taken (the one with the most zero bits
+	at the bottom), so the tasks that their windows overlap mostly get the
+	same tick - and run in one wake up */
+static unsigned long WheelTickOf(const sched_t *sched, const task_t *task)
+{
+	/* rounded up to a whole tick, so the task never runs early */
+	unsigned long first = (unsigned long)((SCHTaskGetNextCall(task) +
+										   sched->wheel_tick - 1) / sched->wheel_tick);
+	unsigned long last = (unsigned long)(SCHTaskGetDeadline(task) / sched->wheel_tick);
+	unsigned long mask = 0;
+
+	if (last <= first)
+	{
+		return (first);
+	}
+
+	/* the top bit that they differ in - below it, 'last' is cleared */
+	mask = last ^ first;
+	while (0 != (mask & (mask - 1)))
+	{
+		mask &= (mask - 1);
+	}
+
+	return (last & ~(mask - 1));
+}
+
+/**************************************************************************/
+
+/* to insert a task to the store of the scheduler.
+	returns 0 for success, and 1 for failure */
+static int StoreInsert(sched_t *sched, task_t *task)
+{
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		TWInsert(sched->wheel, SCHTaskGetWheelNode(task), WheelTickOf(sched, task));
+
+		return (0);
+	}
+
+	return (PQEnqueue(sched->pq, task));
+}
+
+/**************************************************************************/
+
+/* to take a given task out of the store (if it's there) */
+static void StoreDetach(sched_t *sched, task_t *task)
+{
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		if (NULL != SCHTaskGetWheelNode(task)->next)
+		{
+			TWRemove(sched->wheel, SCHTaskGetWheelNode(task));
+		}
+
+		return;
+	}
+
+	PQEraseData(sched->pq, task);
+}
+
+/**************************************************************************/
+
+/* to take out of the store all the tasks that their time has come
+	(up to 'max' tasks), by their order.
+	the pqueue is by deadline, so it stops at the first task that its next
+	run time didn't come (the ones after it are taken by its deadline).
+	returns the number of tasks that were taken */
+static size_t StorePopDue(sched_t *sched, sched_time_t now, task_t **batch,
+						  size_t max)
+{
+	tw_node_t *node = NULL;
+	size_t count = 0;
+
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		for (count = 0; count < max; ++count)
+		{
+			node = TWPopExpired(sched->wheel, (unsigned long)(now / sched->wheel_tick));
+			if (NULL == node)
+			{
+				break;
+			}
+
+			batch[count] = SCHTaskFromWheelNode(node);
+		}
+
+		return (count);
+	}
+
+	for (count = 0; count < max; ++count)
+	{
+		batch[count] = PQPeek(sched->pq);
+		if ((NULL == batch[count]) || (SCHTaskGetNextCall(batch[count]) > now))
+		{
+			break;
+		}
+
+		PQDequeue(sched->pq);
+	}
+
+	return (count);
+}
+
+/**************************************************************************/
+
+/* to put back some tasks to the store at once.
+	nothing is allocated - the heap has room for the tasks that were taken
+	out of it, the nodes of the list wait in its pool, and the wheel links
+	the node of the task.
+	returns 0 for success, and 1 for failure */
+static int StoreInsertBatch(sched_t *sched, task_t **batch, size_t count)
+{
+	size_t i = 0;
+
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		for (i = 0; i < count; ++i)
+		{
+			StoreInsert(sched, batch[i]);
+		}
+
+		return (0);
+	}
+
+	return (PQEnqueueBatch(sched->pq, (void **)batch, count));
+}
+
+/**************************************************************************/
+
+/* to put a task back to its place by its new time.
+	nothing is allocated - the task is sifted in the pqueue, and its own node
+	is relinked in the wheel */
+static void StoreRequeue(sched_t *sched, task_t *task)
+{
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		StoreDetach(sched, task);
+		StoreInsert(sched, task);
+
+		return;
+	}
+
+	PQUpdate(sched->pq, task);
+}
+
+/**************************************************************************/
+
+/* to get the time that the scheduler has to wake up at - the first
+	deadline, so every task that its next run time came by then runs in
+	the same wake up.
+	the store must not be empty */
+static sched_time_t StoreNextCall(const sched_t *sched)
+{
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		return ((sched_time_t)TWNextExpiry(sched->wheel) * sched->wheel_tick);
+	}
+
+	return (SCHTaskGetDeadline(PQPeek(sched->pq)));
+}
+
+/**************************************************************************/
+
+/* to check if the store is empty.
+	returns 1 if empty, 0 - otherwise */
+static int StoreIsEmpty(const sched_t *sched)
+{
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		return (TWIsEmpty(sched->wheel));
+	}
+
+	return (PQIsEmpty(sched->pq));
+}
+
+/**************************************************************************/
+
+/* to check if the tasks belong to another thread - the thread of SCHRun
+	while it runs, and the thread that created the scheduler otherwise.
+	then they are changed only by a request to the thread of SCHRun.
+	returns 1 if they belong to another thread, 0 - otherwise */
+static int IsOtherThread(sched_t *sched)
+{
+	/* the atomic read sees the run thread that was set before the flag */
+	if (0 != __sync_fetch_and_add(&sched->is_in_run, 0))
+	{
+		return (0 == pthread_equal(pthread_self(), sched->run_thread));
+	}
+
+	return (0 == pthread_equal(pthread_self(), sched->owner));
+}
+
+/**************************************************************************/
+
+/* to check if SCHStop was called.
+	returns 1 if it was, 0 - otherwise */
+static int IsStopped(sched_t *sched)
+{
+	return (0 != __sync_fetch_and_add(&sched->to_exit, 0));
+}
+
+/**************************************************************************/
+
+static sch_cmd_t *NewCommand(sch_cmd_type_t type)
+{
+	sch_cmd_t *cmd = (sch_cmd_t *)malloc(sizeof(sch_cmd_t));
+	if (NULL == cmd)
+	{
+		return (NULL);
+	}
+
+	cmd->node.next = NULL;
+	cmd->type = type;
+	cmd->tasks = &cmd->task;
+	cmd->count = 0;
+	cmd->task = NULL;
+	cmd->interval = 0;
+	cmd->deadline = 0;
+	cmd->is_interval = 0;
+	cmd->fd = -1;
+	cmd->events = 0;
+	cmd->fd_func = NULL;
+	cmd->arg = NULL;
+
+	return (cmd);
+}
+
+/**************************************************************************/
+
+static void FreeCommand(sch_cmd_t *cmd)
+{
+	if (&cmd->task != cmd->tasks)
+	{
+		free(cmd->tasks); cmd->tasks = NULL;
+	}
+
+	free(cmd); cmd = NULL;
+}
+
+/**************************************************************************/
+
+/* to send a request to the thread of SCHRun.
+	the loop is woken up only by the request that finds the queue empty -
+	the next ones are taken in the same wake up */
+static void Submit(sched_t *sched, sch_cmd_t *cmd)
+{
+	if (1 == MPSCPush(sched->commands, &cmd->node))
+	{
+		EVWake(sched->loop);
+	}
+}
+
+/**************************************************************************/
+
+static void DestroyTasks(task_t **tasks, size_t count)
+{
+	size_t i = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		SCHTaskDestroy(tasks[i]);
+	}
+}
+
+/**************************************************************************/
+
+/* to add tasks that were created to the map of uids and to the store at once.
+	returns 0 for success, and 1 for failure (then the tasks are destroyed) */
+static int InsertTasks(sched_t *sched, task_t **tasks, size_t count)
+{
+	size_t i = 0;
+
+	/* with room in the map, adding the tasks to it can't fail */
+	if (1 == UIDMapReserve(sched->tasks, UIDMapSize(sched->tasks) + count))
+	{
+		DestroyTasks(tasks, count);
+
+		return (1);
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		UIDMapInsert(sched->tasks, SCHTaskGetUid(tasks[i]), tasks[i]);
+	}
+
+	/* the store sorts the array of the tasks */
+	if (1 == StoreInsertBatch(sched, tasks, count))
+	{
+		for (i = 0; i < count; ++i)
+		{
+			UIDMapRemove(sched->tasks, SCHTaskGetUid(tasks[i]));
+		}
+
+		DestroyTasks(tasks, count);
+
+		return (1);
+	}
+
+	return (0);
+}
+
+/**************************************************************************/
+
+/* to find the place of a task in the batch - between the tasks that wait
+	to run, or the tasks that ran and wait to go back to the store.
+	returns NULL if the task isn't in the batch */
+static task_t **FindInBatch(sched_t *sched, const task_t *task)
+{
+	size_t i = 0;
+
+	for (i = 0; i < sched->batch_size; ++i)
+	{
+		if (((i < sched->batch_kept) || (i >= sched->batch_next)) &&
+			(task == sched->batch[i]))
+		{
+			return (&sched->batch[i]);
+		}
+	}
+
+	return (NULL);
+}
+
+/**************************************************************************/
+
+/* to move a task to a new run time */
+static int Move(sched_t *sched, uid_type uid, sched_time_t interval,
+				sched_time_t deadline, int is_interval)
+{
+	task_t *task = NULL;
+	sch_cmd_t *cmd = NULL;
+
+	/* the task is moved in the next wake up of SCHRun */
+	if (1 == IsOtherThread(sched))
+	{
+		cmd = NewCommand(SCH_CMD_MOVE);
+		if (NULL == cmd)
+		{
+			return (1);
+		}
+
+		cmd->uid = uid;
+		cmd->interval = interval;
+		cmd->deadline = deadline;
+		cmd->is_interval = is_interval;
+		Submit(sched, cmd);
+
+		return (0);
+	}
+
+	task = (task_t *)UIDMapFind(sched->tasks, uid);
+	if (NULL == task)
+	{
+		return (1);
+	}
+
+	if (1 == is_interval)
+	{
+		SCHTaskSetInterval(task, interval);
+	}
+
+	SCHTaskSetNextCall(task, deadline);
+
+	/* a task out of the store goes back to it by its new time,
+		and a running task keeps the new time when it returns */
+	if (0 != (SCHTaskGetState(task) & SCH_TASK_RUNNING))
+	{
+		SCHTaskSetState(task, SCHTaskGetState(task) | SCH_TASK_MOVED);
+	}
+	else if (NULL == FindInBatch(sched, task))
+	{
+		StoreRequeue(sched, task);
+	}
+
+	return (0);
+}
+
+/**************************************************************************/
+
+/* to handle a task that its func returned.
+	returns 1 if the task reruns (it has its next time already),
+	0 if it was destroyed, and 2 if it was destroyed after it failed */
+static int Finish(sched_t *sched, task_t *task, int res_run)
+{
+	unsigned int state = SCHTaskGetState(task);
+
+	SCHTaskEndRun(task);
+
+	HistRecord(sched->lateness, SCHTaskGetLateness(task));
+	HistRecord(sched->run_time, SCHTaskGetRunTime(task));
+	++sched->runs;
+
+	if ((1 == res_run) && (0 == (state & SCH_TASK_REMOVED)))
+	{
+		/* a task that was rescheduled while it ran has its time already */
+		if (0 == (state & SCH_TASK_MOVED))
+		{
+			size_t missed = SCHTaskGetMissed(task);
+
+			SCHTaskUpdateNextCall(task);
+			sched->missed += SCHTaskGetMissed(task) - missed;
+		}
+
+		return (1);
+	}
+
+	if (0 == (state & SCH_TASK_REMOVED))
+	{
+		UIDMapRemove(sched->tasks, SCHTaskGetUid(task));
+	}
+
+	SCHTaskDestroy(task);
+
+	return ((-1 == res_run) ? 2 : 0);
+}
+
+/**************************************************************************/
+
+/* to put back at once the tasks that rerun.
+	returns 2 if they couldn't go back (then they are destroyed), 0 - otherwise */
+static int PutBack(sched_t *sched, task_t **tasks, size_t count)
+{
+	size_t i = 0;
+
+	if (0 == StoreInsertBatch(sched, tasks, count))
+	{
+		return (0);
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		UIDMapRemove(sched->tasks, SCHTaskGetUid(tasks[i]));
+		SCHTaskDestroy(tasks[i]);
+	}
+
+	return (2);
+}
+
+/**************************************************************************/
+
+/* to run the tasks of the batch (or give them to the workers),
+	and put back at once the ones that rerun.
+	returns 2 if a task failed, 0 - otherwise */
+static int RunBatch(sched_t *sched, sched_time_t now)
+{
+	task_t *task = NULL;
+	size_t count = 0;
+	size_t i = 0;
+	int flag = 0;
+
+	sched->batch_next = 0;
+	sched->batch_kept = 0;
+
+	while (sched->batch_next < sched->batch_size)
+	{
+		task = sched->batch[sched->batch_next];
+		++sched->batch_next;
+
+		/* the task was removed while it waited */
+		if (NULL == task)
+		{
+			continue;
+		}
+
+		/* the task was rescheduled while it waited, or the scheduler stopped */
+		if ((1 == IsStopped(sched)) || (SCHTaskGetNextCall(task) > now))
+		{
+			sched->batch[sched->batch_kept] = task;
+			++sched->batch_kept;
+
+			continue;
+		}
+
+		SCHTaskBeginRun(task);
+
+		/* a worker runs the task, and it comes back by CollectDone.
+			if the workers can't take it - it runs here */
+		if ((NULL != sched->workers) && (0 == WPSubmit(sched->workers, task)))
+		{
+			++sched->in_flight;
+
+			continue;
+		}
+
+		switch (Finish(sched, task, SCHTaskRun(task)))
+		{
+			/* if the task needs to run again - it waits for the end of the batch */
+			case 1:
+				sched->batch[sched->batch_kept] = task;
+				++sched->batch_kept;
+				break;
+
+			/* if the task finished with error */
+			case 2:
+				flag = 2;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	/* the tasks that were removed after they ran left empty places */
+	for (i = 0; i < sched->batch_kept; ++i)
+	{
+		if (NULL != sched->batch[i])
+		{
+			sched->batch[count] = sched->batch[i];
+			++count;
+		}
+	}
+
+	sched->batch_size = 0;
+	sched->batch_next = 0;
+	sched->batch_kept = 0;
+
+	return (PutBack(sched, sched->batch, count) | flag);
+}
+
+/**************************************************************************/
+
+/* to handle the tasks that the workers are done with,
+	and put back at once the ones that rerun.
+	returns 2 if a task failed, 0 - otherwise */
+static int CollectDone(sched_t *sched)
+{
+	task_t *task = NULL;
+	size_t count = 0;
+	int res_run = 0;
+	int flag = 0;
+
+	/* the batch is empty between wake ups, so it holds the tasks that rerun */
+	while (NULL != (task = (task_t *)WPTakeDone(sched->workers, &res_run)))
+	{
+		--sched->in_flight;
+
+		switch (Finish(sched, task, res_run))
+		{
+			case 1:
+				sched->batch[count] = task;
+				++count;
+				break;
+
+			case 2:
+				flag = 2;
+				break;
+
+			default:
+				break;
+		}
+
+		if (SCH_BATCH_MAX == count)
+		{
+			flag |= PutBack(sched, sched->batch, count);
+			count = 0;
+		}
+	}
+
+	return (PutBack(sched, sched->batch, count) | flag);
+}
+
+/**************************************************************************/
+
+/* the func of the workers */
+static int RunOnWorker(void *task)
+{
+	return (SCHTaskRun((task_t *)task));
+}
+
+/**************************************************************************/
+
+/* to wake up the run loop when a worker is done with a task */
+static void NotifyDone(void *sched)
+{
+	EVWake(((sched_t *)sched)->loop);
+}
+
+/**************************************************************************/
+
+/* to mark a running task as removed */
+static int MarkRemoved(void *task, void *param)
+{
+	unsigned int state = SCHTaskGetState((task_t *)task);
+
+	(void)param;
+
+	if (0 != (state & SCH_TASK_RUNNING))
+	{
+		SCHTaskSetState((task_t *)task, state | SCH_TASK_REMOVED);
+	}
+
+	return (0);
+}
+
+/**************************************************************************/
+
+/* to put a task in its place in the list of the most expensive tasks
+	(if it's one of them) */
+static int AddToTop(void *task, void *top)
+{
+	sch_top_t *list = (sch_top_t *)top;
+	sched_time_t cpu_time = SCHTaskGetTotalCpu((task_t *)task);
+	size_t i = list->count;
+
+	if (list->count == list->max)
+	{
+		if ((0 == list->max) || (cpu_time <= list->costs[list->max - 1].cpu_time))
+		{
+			return (0);
+		}
+
+		/* the cheapest one leaves the list */
+		i = list->max - 1;
+	}
+	else
+	{
+		++list->count;
+	}
+
+	while ((0 < i) && (list->costs[i - 1].cpu_time < cpu_time))
+	{
+		list->costs[i] = list->costs[i - 1];
+		--i;
+	}
+
+	list->costs[i].uid = SCHTaskGetUid((task_t *)task);
+	list->costs[i].arg = SCHTaskGetParam((task_t *)task);
+	list->costs[i].runs = SCHTaskGetRuns((task_t *)task);
+	list->costs[i].cpu_time = cpu_time;
+	list->costs[i].wall_time = SCHTaskGetTotalWall((task_t *)task);
+	list->costs[i].missed = SCHTaskGetMissed((task_t *)task);
+
+	return (0);
+}
+
+/**************************************************************************/
+
+/* to do the requests of the other threads, by their order.
+	the tasks of the adds that come one after the other go to the store
+	together (up to SCH_BATCH_MAX at once).
+	returns 2 if a task couldn't be added, 0 - otherwise */
+static int DrainCommands(sched_t *sched)
+{
+	mpsc_node_t *node = MPSCTakeAll(sched->commands);
+	task_t *adds[SCH_BATCH_MAX];
+	sch_cmd_t *cmd = NULL;
+	size_t count = 0;
+	int flag = 0;
+
+	while (NULL != node)
+	{
+		cmd = (sch_cmd_t *)node;
+		node = node->next;
+
+		/* the adds wait for a request that may need their tasks */
+		if ((0 < count) &&
+			((SCH_CMD_ADD != cmd->type) || (SCH_BATCH_MAX < count + cmd->count)))
+		{
+			if (1 == InsertTasks(sched, adds, count))
+			{
+				flag = 2;
+			}
+
+			count = 0;
+		}
+
+		switch (cmd->type)
+		{
+			case SCH_CMD_ADD:
+				if (SCH_BATCH_MAX < cmd->count)
+				{
+					if (1 == InsertTasks(sched, cmd->tasks, cmd->count))
+					{
+						flag = 2;
+					}
+				}
+				else
+				{
+					memcpy(adds + count, cmd->tasks, cmd->count * sizeof(task_t *));
+					count += cmd->count;
+				}
+				break;
+
+			case SCH_CMD_REMOVE:
+				SCHRemove(sched, cmd->uid);
+				break;
+
+			case SCH_CMD_MOVE:
+				Move(sched, cmd->uid, cmd->interval, cmd->deadline,
+					 cmd->is_interval);
+				break;
+
+			case SCH_CMD_ADD_FD:
+				if (1 == EVAddFd(sched->loop, cmd->fd, cmd->events,
+								 cmd->fd_func, cmd->arg))
+				{
+					flag = 2;
+				}
+				break;
+
+			case SCH_CMD_REMOVE_FD:
+				EVRemoveFd(sched->loop, cmd->fd);
+				break;
+		}
+
+		FreeCommand(cmd);
+	}
+
+	if ((0 < count) && (1 == InsertTasks(sched, adds, count)))
+	{
+		flag = 2;
+	}
+
+	return (flag);
+}
+
+/**************************************************************************/
+
+/* to drop the requests of the other threads (the new tasks are destroyed) */
+static void DiscardCommands(sched_t *sched)
+{
+	mpsc_node_t *node = MPSCTakeAll(sched->commands);
+	sch_cmd_t *cmd = NULL;
+
+	while (NULL != node)
+	{
+		cmd = (sch_cmd_t *)node;
+		node = node->next;
+
+		if (SCH_CMD_ADD == cmd->type)
+		{
+			DestroyTasks(cmd->tasks, cmd->count);
+		}
+
+		FreeCommand(cmd);
+	}
+}
+
+/**************************************************************************/
+
+/* to create a task with its slack, and its dynamic func (if there is one) */
+static task_t *NewTask(sched_t *sched, int (*func)(void *arg),
+					   int (*next_func)(void *arg, sched_time_t *next), void *arg,
+					   sched_time_t interval, sched_time_t slack, pool_t *pool)
+{
+	task_t *new_task = SCHTaskCreate(func, interval, arg, pool, sched->clock);
+	if (NULL == new_task)
+	{
+		return (NULL);
+	}
+
+	SCHTaskSetSlack(new_task, slack);
+
+	if (NULL != next_func)
+	{
+		SCHTaskSetNextFunc(new_task, next_func);
+	}
+
+	return (new_task);
+}
+
+/**************************************************************************/
+
+/* to create a new task (with 'func' or 'next_func') and add it to the
+	scheduler, or send it to the thread of SCHRun.
+	returns the new uid of the task (a bad uid for failure) */
+static uid_type Add(sched_t *sched, int (*func)(void *arg),
+					int (*next_func)(void *arg, sched_time_t *next), void *arg,
+					sched_time_t interval, sched_time_t slack)
+{
+	task_t *new_task = NULL;
+	sch_cmd_t *cmd = NULL;
+	uid_type error_uid = {0};
+
+	/* the pool of the tasks belongs to the thread of SCHRun,
+		so a task of another thread is allocated by itself */
+	if (1 == IsOtherThread(sched))
+	{
+		new_task = NewTask(sched, func, next_func, arg, interval, slack, NULL);
+		cmd = NewCommand(SCH_CMD_ADD);
+		if ((NULL == new_task) || (NULL == cmd))
+		{
+			if (NULL != new_task)
+			{
+				SCHTaskDestroy(new_task); new_task = NULL;
+			}
+
+			free(cmd); cmd = NULL;
+
+			error_uid = UIDCreate();
+			error_uid.counter = 0;
+
+			return (error_uid);
+		}
+
+		/* the task belongs to the scheduler once it's sent */
+		error_uid = SCHTaskGetUid(new_task);
+		cmd->task = new_task;
+		cmd->count = 1;
+		Submit(sched, cmd);
+
+		return (error_uid);
+	}
+
+	new_task = NewTask(sched, func, next_func, arg, interval, slack, sched->task_pool);
+
+	/* if SCHTaskCreate failed */
+	if (NULL == new_task)
+	{
+		error_uid = UIDCreate();
+		error_uid.counter = 0;
+
+		return (error_uid);
+	}
+
+	/* to insert the task to the scheduler and to the map of uids,
+	   and check if the insert failed */
+	if (1 == StoreInsert(sched, new_task))
+	{
+		SCHTaskDestroy(new_task); new_task = NULL;
+
+		error_uid = UIDCreate();
+		error_uid.counter = 0;
+
+		return (error_uid);
+	}
+
+	if (1 == UIDMapInsert(sched->tasks, SCHTaskGetUid(new_task), new_task))
+	{
+		StoreDetach(sched, new_task);
+		SCHTaskDestroy(new_task); new_task = NULL;
+
+		error_uid = UIDCreate();
+		error_uid.counter = 0;
+
+		return (error_uid);
+	}
+
+	return (SCHTaskGetUid(new_task));
+}
+
+/**************************************************************************/
+
+/* to init the attributes of a scheduler to the default values */
+void SCHAttrInit(sched_attr_t *attr)
+{
+	/* checking parameters */
+	assert(NULL != attr);
+
+	attr->backend = SCH_BACKEND_HEAP;
+	attr->wheel_tick = SCH_MSEC(1);
+	attr->prealloc = 0;
+	attr->workers = 0;
+	attr->clock = NULL;
+}
 
 /**************************************************************************/
 
 /* to create a new scheduler.
 	the function also creates a pqueue to store all the tasks.
-	returns a pointer to the new scheduler 
+	returns a pointer to the new scheduler
 	(and if the malloc failled - returns NULL) */
 sched_t *SCHCreate(void)
 {
-	sched_t *new_sched = (sched_t *)malloc(sizeof(sched_t));
+	sched_attr_t attr;
+
+	SCHAttrInit(&attr);
+
+	return (SCHCreateWithAttr(&attr));
+}
+
+/**************************************************************************/
+
+/* to create a new scheduler by given attributes.
+	returns a pointer to the new scheduler
+	(and if the malloc failled - returns NULL) */
+sched_t *SCHCreateWithAttr(const sched_attr_t *attr)
+{
+	sched_t *new_sched = NULL;
+
+	/* checking parameters */
+	assert((NULL != attr) && (0 < attr->wheel_tick));
+
+	new_sched = (sched_t *)malloc(sizeof(sched_t));
 	if (NULL == new_sched)
 	{
-		return (NULL);
+		return (NULL);
+	}
+
+	new_sched->backend = attr->backend;
+	new_sched->pq = NULL;
+	new_sched->wheel = NULL;
+	new_sched->wheel_tick = attr->wheel_tick;
+	new_sched->clock = attr->clock;
+	new_sched->loop = NULL;
+	new_sched->batch_size = 0;
+	new_sched->batch_next = 0;
+	new_sched->batch_kept = 0;
+	new_sched->workers = NULL;
+	new_sched->in_flight = 0;
+	new_sched->owner = pthread_self();
+	new_sched->is_in_run = 0;
+	new_sched->to_exit = 0;
+	new_sched->lateness = NULL;
+	new_sched->run_time = NULL;
+	new_sched->runs = 0;
+	new_sched->missed = 0;
+	new_sched->stats_since = Now(new_sched);
+
+	/* the queue that other threads send their requests by */
+	new_sched->commands = MPSCCreate();
+	if (NULL == new_sched->commands)
+	{
+		free(new_sched); new_sched = NULL;
+
+		return (NULL);
+	}
+
+	/* the tasks come from a pool, so a running scheduler
+		doesn't allocate them one by one */
+	new_sched->task_pool = PoolCreate(SCHTaskSize(), attr->prealloc);
+	if (NULL == new_sched->task_pool)
+	{
+		MPSCDestroy(new_sched->commands); new_sched->commands = NULL;
+		free(new_sched); new_sched = NULL;
+
+		return (NULL);
+	}
+
+	/* to find a task by its uid without a search */
+	new_sched->tasks = UIDMapCreate();
+	if ((NULL == new_sched->tasks) ||
+		(1 == UIDMapReserve(new_sched->tasks, attr->prealloc)))
+	{
+		if (NULL != new_sched->tasks)
+		{
+			UIDMapDestroy(new_sched->tasks); new_sched->tasks = NULL;
+		}
+
+		PoolDestroy(new_sched->task_pool); new_sched->task_pool = NULL;
+		MPSCDestroy(new_sched->commands); new_sched->commands = NULL;
+		free(new_sched); new_sched = NULL;
+
+		return (NULL);
+	}
+
+	/* to create the store of the tasks */
+	if (SCH_BACKEND_WHEEL == attr->backend)
+	{
+		new_sched->wheel = TWCreate((unsigned long)(Now(new_sched) / attr->wheel_tick));
+	}
+	else
+	{
+		new_sched->pq = PQCreate(&SCHTaskIsBefore, NULL,
+					(SCH_BACKEND_HEAP == attr->backend) ? PQ_HEAP : PQ_SORTED_LIST,
+					&SCHTaskGetQueueIndex);
+	}
+
+	if ((NULL == new_sched->pq) && (NULL == new_sched->wheel))
+	{
+		UIDMapDestroy(new_sched->tasks); new_sched->tasks = NULL;
+		PoolDestroy(new_sched->task_pool); new_sched->task_pool = NULL;
+		MPSCDestroy(new_sched->commands); new_sched->commands = NULL;
+		free(new_sched); new_sched = NULL;
+
+		return (NULL);
+	}
+
+	/* to create the loop that the scheduler waits in, the histograms of
+		the runs, and make room for the preallocated tasks in the pqueue */
+	new_sched->loop = EVCreate();
+	new_sched->lateness = HistCreate();
+	new_sched->run_time = HistCreate();
+	if ((NULL == new_sched->loop) || (NULL == new_sched->lateness) ||
+		(NULL == new_sched->run_time) ||
+		((NULL != new_sched->pq) && (1 == PQReserve(new_sched->pq, attr->prealloc))))
+	{
+		SCHDestroy(new_sched); new_sched = NULL;
+
+		return (NULL);
+	}
+
+	/* to create the workers that run the funcs of the tasks
+		(with a virtual clock the funcs run in SCHRun, one after the other) */
+	if ((0 < attr->workers) && (0 == IsVirtual(new_sched)))
+	{
+		new_sched->workers = WPCreate(attr->workers, &RunOnWorker, &NotifyDone,
+									  new_sched);
+		if (NULL == new_sched->workers)
+		{
+			SCHDestroy(new_sched); new_sched = NULL;
+
+			return (NULL);
+		}
+	}
+
+	return (new_sched);
+}
+
+/**************************************************************************/
+
+/* to free the memory of the scheduler */
+void SCHDestroy(sched_t *sched)
+{
+	/* checking parameters */
+	assert(NULL != sched);
+
+	/* the workers are idle - SCHRun waits for them before it returns */
+	if (NULL != sched->workers)
+	{
+		WPDestroy(sched->workers); sched->workers = NULL;
+	}
+
+	SCHClearAll(sched);
+
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		TWDestroy(sched->wheel);
+	}
+	else
+	{
+		PQDestroy(sched->pq);
+	}
+
+	if (NULL != sched->loop)
+	{
+		EVDestroy(sched->loop);
+	}
+
+	if (NULL != sched->lateness)
+	{
+		HistDestroy(sched->lateness);
 	}
-	
-	/* to create a task */
-	new_sched->pq = PQCreate(&SCHTaskIsBefore, NULL);
-	if (NULL == new_sched->pq)
+
+	if (NULL != sched->run_time)
 	{
-		free(new_sched); new_sched = NULL;
-		
-		return (NULL);
+		HistDestroy(sched->run_time);
 	}
-	
-	new_sched->to_exit = 0;
-	
-	return (new_sched);
-}
 
-/**************************************************************************/
+	UIDMapDestroy(sched->tasks); sched->tasks = NULL;
+	PoolDestroy(sched->task_pool); sched->task_pool = NULL;
+	MPSCDestroy(sched->commands); sched->commands = NULL;
 
-/* to free the memory of the scheduler */
-void SCHDestroy(sched_t *sched)
-{
-	/* checking parameters */
-	assert(NULL != sched);
-	
-	SCHClearAll(sched);
-	PQDestroy(sched->pq);
 	free(sched); sched = NULL;
 }
 
@@ -62,7 +1164,7 @@ int SCHIsEmpty(const sched_t *sched)
 	/* checking parameters */
 	assert(NULL != sched);
 
-	return (PQIsEmpty(sched->pq));
+	return (0 == SCHSize(sched));
 }
 
 /**************************************************************************/
@@ -72,157 +1174,586 @@ size_t SCHSize(const sched_t *sched)
 {
 	/* checking parameters */
 	assert(NULL != sched);
-	
-	return (PQSize(sched->pq));
+
+	/* every task that wasn't removed has its uid in the map */
+	return (UIDMapSize(sched->tasks));
 }
 
 /**************************************************************************/
 
 /* to remove a specific task from the scheduler.
+	from another thread, the task is removed in the next wake up of SCHRun,
+	and 0 means that the request was sent.
   returns 0 for success, and 1 if there is no task to remove */
 int SCHRemove(sched_t *sched, uid_type uid)
 {
 	task_t *erased = NULL;
-	
+	task_t **place = NULL;
+	sch_cmd_t *cmd = NULL;
+
 	/* checking parameters */
 	assert(NULL != sched);
 
-	erased = PQErase(sched->pq, &SCHTaskIsMatch, &uid);
-	
+	if (1 == IsOtherThread(sched))
+	{
+		cmd = NewCommand(SCH_CMD_REMOVE);
+		if (NULL == cmd)
+		{
+			return (1);
+		}
+
+		cmd->uid = uid;
+		Submit(sched, cmd);
+
+		return (0);
+	}
+
+	/* the uid leads straight to the task - there is no search */
+	erased = (task_t *)UIDMapRemove(sched->tasks, uid);
 	if (NULL == erased)
 	{
 		return (1);
 	}
-	
+
+	/* a running task is destroyed when it returns */
+	if (0 != (SCHTaskGetState(erased) & SCH_TASK_RUNNING))
+	{
+		SCHTaskSetState(erased, SCHTaskGetState(erased) | SCH_TASK_REMOVED);
+
+		return (0);
+	}
+
+	/* a task of the batch leaves an empty place there */
+	place = FindInBatch(sched, erased);
+	if (NULL != place)
+	{
+		*place = NULL;
+	}
+	else
+	{
+		StoreDetach(sched, erased);
+	}
+
 	SCHTaskDestroy(erased);
-	
-	return (0);	
+
+	return (0);
+}
+
+/**************************************************************************/
+
+/* to change the interval of a task, and run it 'interval' nanoseconds
+	from now (the uid stays the same, and nothing is allocated).
+	can be called from the task itself - then it reruns by the new time.
+	from another thread, the task is moved in the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 if there is no such task */
+int SCHReschedule(sched_t *sched, uid_type uid, sched_time_t interval)
+{
+	/* checking parameters */
+	assert((NULL != sched) && (0 <= interval));
+
+	return (Move(sched, uid, interval, Now(sched) + interval, 1));
+}
+
+/**************************************************************************/
+
+/* to run a task at the absolute time 'deadline' (on the clock of the
+	scheduler - SCHTimeNow by default), and then every its interval as before.
+	from another thread, the task is moved in the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 if there is no such task */
+int SCHRescheduleAt(sched_t *sched, uid_type uid, sched_time_t deadline)
+{
+	/* checking parameters */
+	assert(NULL != sched);
+
+	return (Move(sched, uid, 0, deadline, 0));
+}
+
+/**************************************************************************/
+
+/* to set what a periodic task does with the runs that it missed after
+	a stall (SCH_CATCH_UP_ALL by default - every missed run, one after
+	the other).
+	returns 0 for success, and 1 if there is no such task */
+int SCHSetCatchUp(sched_t *sched, uid_type uid, sch_catch_up_t catch_up)
+{
+	task_t *task = NULL;
+
+	/* checking parameters */
+	assert(NULL != sched);
+
+	task = (task_t *)UIDMapFind(sched->tasks, uid);
+	if (NULL == task)
+	{
+		return (1);
+	}
+
+	SCHTaskSetCatchUp(task, catch_up);
+
+	return (0);
 }
 
 /**************************************************************************/
 
-/* to clear all the tasks of the scheduler */
+/* to count the runs of a task that its catch up policy dropped.
+	returns 0 for success, and 1 if there is no such task */
+int SCHGetMissed(const sched_t *sched, uid_type uid, size_t *missed)
+{
+	task_t *task = NULL;
+
+	/* checking parameters */
+	assert((NULL != sched) && (NULL != missed));
+
+	task = (task_t *)UIDMapFind(sched->tasks, uid);
+	if (NULL == task)
+	{
+		return (1);
+	}
+
+	*missed = SCHTaskGetMissed(task);
+
+	return (0);
+}
+
+/**************************************************************************/
+
+/* to clear all the tasks of the scheduler
+	(and the tasks that other threads asked to add) */
 void SCHClearAll(sched_t *sched)
 {
+	size_t i = 0;
+
 	/* checking parameters */
 	assert(NULL != sched);
 
+	DiscardCommands(sched);
+
+	/* the running tasks are destroyed when they return */
+	UIDMapForEach(sched->tasks, &MarkRemoved, NULL);
+
+	/* the tasks that are out of the store in the batch */
+	for (i = 0; i < sched->batch_size; ++i)
+	{
+		if (((i < sched->batch_kept) || (i >= sched->batch_next)) &&
+			(NULL != sched->batch[i]))
+		{
+			SCHTaskDestroy(sched->batch[i]);
+		}
+	}
+
+	sched->batch_size = 0;
+	sched->batch_next = 0;
+	sched->batch_kept = 0;
+
+	UIDMapClear(sched->tasks);
+
+	if (SCH_BACKEND_WHEEL == sched->backend)
+	{
+		TWClear(sched->wheel, &DestroyWheelNode);
+
+		return;
+	}
+
+	/* the task keeps its place in the queue, so it leaves it before it's freed */
 	while (0 == PQIsEmpty(sched->pq))
 	{
-		SCHTaskDestroy(PQPeek(sched->pq));
+		task_t *task = PQPeek(sched->pq);
+
 		PQDequeue(sched->pq);
+		SCHTaskDestroy(task);
 	}
 }
 
 /**************************************************************************/
 
-/* to stop the scheduler from running */
+/* to get the stats of the runs since the scheduler was created
+	(or since SCHResetStats) */
+void SCHGetStats(const sched_t *sched, sched_stats_t *stats)
+{
+	/* checking parameters */
+	assert((NULL != sched) && (NULL != stats));
+
+	stats->lateness_p50 = HistPercentile(sched->lateness, 50);
+	stats->lateness_p99 = HistPercentile(sched->lateness, 99);
+	stats->lateness_max = HistMax(sched->lateness);
+	stats->run_time_p50 = HistPercentile(sched->run_time, 50);
+	stats->run_time_p99 = HistPercentile(sched->run_time, 99);
+	stats->run_time_max = HistMax(sched->run_time);
+	stats->queue_depth = SCHSize(sched);
+	stats->runs = sched->runs;
+	stats->missed = sched->missed;
+	stats->period = Now(sched) - sched->stats_since;
+	stats->runs_per_sec = (0 < stats->period) ?
+						  ((double)sched->runs * SCH_SEC(1) / stats->period) : 0;
+}
+
+/**************************************************************************/
+
+/* to start the stats again from now */
+void SCHResetStats(sched_t *sched)
+{
+	/* checking parameters */
+	assert(NULL != sched);
+
+	HistClear(sched->lateness);
+	HistClear(sched->run_time);
+	sched->runs = 0;
+	sched->missed = 0;
+	sched->stats_since = Now(sched);
+}
+
+/**************************************************************************/
+
+/* to list the tasks that used the most cpu time in their runs, from the
+	most expensive (O(n * max)).
+	up to 'max' tasks are written to 'costs'.
+	returns the number of tasks that were written */
+size_t SCHGetTopTasks(const sched_t *sched, sched_task_cost_t *costs, size_t max)
+{
+	sch_top_t top;
+
+	/* checking parameters */
+	assert((NULL != sched) && ((NULL != costs) || (0 == max)));
+
+	top.costs = costs;
+	top.count = 0;
+	top.max = max;
+
+	UIDMapForEach(sched->tasks, &AddToTop, &top);
+
+	return (top.count);
+}
+
+/**************************************************************************/
+
+/* to stop the scheduler from running.
+	can be called from any thread, and from a signal handler -
+	a waiting scheduler wakes up at once */
 void SCHStop(sched_t *sched)
 {
 	/* checking parameters */
 	assert(NULL != sched);
 
-	sched->to_exit = 1;
+	__sync_lock_test_and_set(&sched->to_exit, 1);
+
+	if (NULL != sched->loop)
+	{
+		EVWake(sched->loop);
+	}
+}
+
+/**************************************************************************/
+
+/* to watch a file descriptor together with the tasks.
+	'func' is called from SCHRun when one of 'events' happens
+	(EV_IN, EV_OUT, EV_ERR), and it returns -1 for failure,
+	0 - success and stop watching, 1 - keep watching.
+	from another thread, the fd is watched from the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 for failure */
+int SCHAddFd(sched_t *sched, int fd, unsigned int events,
+			 int (*func)(int fd, unsigned int events, void *arg), void *arg)
+{
+	sch_cmd_t *cmd = NULL;
+
+	/* checking parameters */
+	assert((NULL != sched) && (NULL != func));
+
+	/* the watchers of the loop belong to the thread of SCHRun */
+	if (1 == IsOtherThread(sched))
+	{
+		cmd = NewCommand(SCH_CMD_ADD_FD);
+		if (NULL == cmd)
+		{
+			return (1);
+		}
+
+		cmd->fd = fd;
+		cmd->events = events;
+		cmd->fd_func = func;
+		cmd->arg = arg;
+		Submit(sched, cmd);
+
+		return (0);
+	}
+
+	return (EVAddFd(sched->loop, fd, events, func, arg));
+}
+
+/**************************************************************************/
+
+/* to stop watching a file descriptor.
+	from another thread, the fd is left in the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 if the fd isn't watched */
+int SCHRemoveFd(sched_t *sched, int fd)
+{
+	sch_cmd_t *cmd = NULL;
+
+	/* checking parameters */
+	assert(NULL != sched);
+
+	if (1 == IsOtherThread(sched))
+	{
+		cmd = NewCommand(SCH_CMD_REMOVE_FD);
+		if (NULL == cmd)
+		{
+			return (1);
+		}
+
+		cmd->fd = fd;
+		Submit(sched, cmd);
+
+		return (0);
+	}
+
+	return (EVRemoveFd(sched->loop, fd));
 }
 
 /**************************************************************************/
 
 /* to create a new task and add it to the scheduler.
+	the task runs every 'due_time' seconds.
 	returns the new uid of the task */
 uid_type SCHAdd(sched_t *sched, int (*func)(void *arg), void *arg, size_t due_time)
 {
-	task_t *new_task = NULL;
-	uid_type error_uid = {0};
+	return (SCHAddInterval(sched, func, arg, SCH_SEC(due_time)));
+}
+
+/**************************************************************************/
+
+/* to create a new task and add it to the scheduler.
+	the task runs every 'interval' nanoseconds
+	(SCH_SEC, SCH_MSEC and SCH_USEC convert to nanoseconds).
+	from another thread, the task is added in the next wake up of SCHRun
+	(its uid is ready at once).
+	returns the new uid of the task */
+uid_type SCHAddInterval(sched_t *sched, int (*func)(void *arg), void *arg,
+						sched_time_t interval)
+{
+	return (SCHAddWithSlack(sched, func, arg, interval, 0));
+}
+
+/**************************************************************************/
 
+/* to create a new task and add it to the scheduler, like SCHAddInterval.
+	every run can be up to 'slack' nanoseconds late, so the tasks that their
+	windows overlap run in one wake up (like the timer slack of the kernel).
+	returns the new uid of the task */
+uid_type SCHAddWithSlack(sched_t *sched, int (*func)(void *arg), void *arg,
+						 sched_time_t interval, sched_time_t slack)
+{
 	/* checking parameters */
-	assert((NULL != sched) && (NULL != func));
+	assert((NULL != sched) && (NULL != func) && (0 <= interval) && (0 <= slack));
 
-	new_task = SCHTaskCreate(func, due_time, arg);
-	
-	/* if SCHTaskCreate failed */
-	if (NULL == new_task)
+	return (Add(sched, func, NULL, arg, interval, slack));
+}
+
+/**************************************************************************/
+
+/* to create a new task that chooses its next run by itself, and add it to
+	the scheduler.
+	the task runs first after 'delay' nanoseconds (and 'slack', like
+	SCHAddWithSlack). 'func' gets 'arg' and a place for the next time
+	(its current interval), and returns:
+	-1 for failure and 0 for success (then the task is removed),
+	1 - to rerun after the same interval,
+	SCH_NEXT_AFTER - to rerun '*next' nanoseconds after the time that the run
+	was due at (the catch up policy of the task counts from there),
+	SCH_NEXT_AT - to rerun at the time '*next' (on the clock of the scheduler).
+	so a task can back off, or poll faster, without removing and adding it.
+	returns the new uid of the task */
+uid_type SCHAddDynamic(sched_t *sched, int (*func)(void *arg, sched_time_t *next),
+					   void *arg, sched_time_t delay, sched_time_t slack)
+{
+	/* checking parameters */
+	assert((NULL != sched) && (NULL != func) && (0 <= delay) && (0 <= slack));
+
+	return (Add(sched, NULL, func, arg, delay, slack));
+}
+
+/**************************************************************************/
+
+/* to create 'count' tasks and add them to the scheduler at once
+	(O(n) for the heap and the wheel, one sort and merge for the list).
+	the uid of every task is written to 'uids' (can be NULL) by the order
+	of 'specs'.
+	from another thread, the tasks are added together in the next wake up
+	of SCHRun.
+	returns 0 for success, and 1 for failure (then no task is added) */
+int SCHAddBatch(sched_t *sched, const sched_task_spec_t *specs, size_t count,
+				uid_type *uids)
+{
+	task_t **new_tasks = NULL;
+	sch_cmd_t *cmd = NULL;
+	pool_t *pool = NULL;
+	size_t created = 0;
+	int res = 0;
+
+	/* checking parameters */
+	assert((NULL != sched) && ((NULL != specs) || (0 == count)));
+
+	if (1 == IsOtherThread(sched))
 	{
-		error_uid = UIDCreate();
-		error_uid.counter = 0;
-		
-		return (error_uid);
+		cmd = NewCommand(SCH_CMD_ADD);
+		if (NULL == cmd)
+		{
+			return (1);
+		}
 	}
-	
-	/* to insert the task to the scheduler, 
-	   and check if PQEnqueue failed */
-	if (1 == PQEnqueue(sched->pq, new_task))
+	else
 	{
-		SCHTaskDestroy(new_task); new_task = NULL;
-		
-		error_uid = UIDCreate();
-		error_uid.counter = 0;
-		
-		return (error_uid);	
+		pool = sched->task_pool;
 	}
-	
-	return (SCHTaskGetUid(new_task));
+
+	new_tasks = (task_t **)malloc((count + 1) * sizeof(task_t *));
+	if (NULL == new_tasks)
+	{
+		free(cmd); cmd = NULL;
+
+		return (1);
+	}
+
+	for (created = 0; created < count; ++created)
+	{
+		assert((NULL != specs[created].func) && (0 <= specs[created].interval) &&
+			   (0 <= specs[created].slack));
+
+		new_tasks[created] = NewTask(sched, specs[created].func, NULL,
+									 specs[created].arg, specs[created].interval,
+									 specs[created].slack, pool);
+		if (NULL == new_tasks[created])
+		{
+			break;
+		}
+
+		if (NULL != uids)
+		{
+			uids[created] = SCHTaskGetUid(new_tasks[created]);
+		}
+	}
+
+	if (created < count)
+	{
+		DestroyTasks(new_tasks, created);
+		free(new_tasks); new_tasks = NULL;
+		free(cmd); cmd = NULL;
+
+		return (1);
+	}
+
+	/* the command takes the array of the tasks with it */
+	if (NULL != cmd)
+	{
+		cmd->tasks = new_tasks;
+		cmd->count = count;
+		Submit(sched, cmd);
+
+		return (0);
+	}
+
+	res = InsertTasks(sched, new_tasks, count);
+
+	free(new_tasks); new_tasks = NULL;
+
+	return (res);
 }
 
 /**************************************************************************/
 
 /* to run a task at run time from the scheduler.
+	the scheduler runs while it has tasks or watched fds.
 	if all the tasks done - returns 0.
 	if the scheduler stopped - returns 1.
 	for any problem - return 2 */
 int SCHRun(sched_t *sched)
 {
-	int res_run = 0;
 	int flag = 0;
-	
+
 	/* checking parameters */
 	assert(NULL != sched);
-	
-	while ((1 != sched->to_exit) && (0 == SCHIsEmpty(sched)))
-	{
-		time_t current = 0;
-		void *data = PQPeek(sched->pq);
-		
-		/* how much time to sleep */
-		double dif = difftime(SCHTaskGetNextCall(data),time(&current));
-		sleep((0 < dif) ? dif : 0);
-		
-		res_run = SCHTaskRun(data);
-		
-		/* if the task needs to run again */
-		if (1 == res_run)
-		{
-			SCHTaskUpdateNextCall(data);
-			PQDequeue(sched->pq);
-			
-			/* if the enqueue failed */
-			if (1 == PQEnqueue(sched->pq, data))
+
+	/* the run thread is set before the flag - the atomic write publishes it */
+	sched->run_thread = pthread_self();
+	__sync_fetch_and_or(&sched->is_in_run, 1);
+
+	while (0 == IsStopped(sched))
+	{
+		sched_time_t now = 0;
+		sched_time_t deadline = 0;
+
+		/* the requests of the other threads come first */
+		if (2 == DrainCommands(sched))
+		{
+			flag = 2;
+		}
+
+		if ((1 == SCHIsEmpty(sched)) && (0 == EVCountFds(sched->loop)))
+		{
+			break;
+		}
+
+		now = Now(sched);
+
+		/* the clock is read once, and all the tasks that are due run together */
+		sched->batch_size = StorePopDue(sched, now, sched->batch, SCH_BATCH_MAX);
+
+		if (0 == sched->batch_size)
+		{
+			deadline = (1 == StoreIsEmpty(sched)) ? -1 : StoreNextCall(sched);
+
+			/* a virtual clock jumps to the next task's time at once
+				(the fds are only checked, without a wait) */
+			if ((1 == IsVirtual(sched)) && (0 <= deadline))
+			{
+				if ((0 != EVCountFds(sched->loop)) && (1 == EVWait(sched->loop, 0)))
+				{
+					flag = 2;
+				}
+
+				sched->clock->advance(sched->clock->arg, deadline);
+			}
+
+			/* to wait for the next task's time (absolute - no drift),
+				for an event of a fd, or for a wake up from another thread */
+			else if (1 == EVWait(sched->loop, deadline))
 			{
-				SCHTaskDestroy(data); data = NULL;
 				flag = 2;
 			}
-			
-			continue;
 		}
-		
-		/* if the task finished with error */
-		if (-1 == res_run)
+		else if (2 == RunBatch(sched, now))
+		{
+			flag = 2;
+		}
+
+		/* the tasks that the workers are done with go back to the store */
+		if ((NULL != sched->workers) && (2 == CollectDone(sched)))
+		{
+			flag = 2;
+		}
+	}
+
+	/* the tasks that the workers still run come back before the scheduler
+		returns (a worker wakes up the loop when it's done) */
+	while (0 < sched->in_flight)
+	{
+		if ((1 == EVWait(sched->loop, -1)) || (2 == CollectDone(sched)))
 		{
 			flag = 2;
 		}
-		
-		SCHTaskDestroy(data);
-		PQDequeue(sched->pq);
 	}
 
 	/* if the user run the stop function */
-	if ((1 == sched->to_exit) && (2 != flag))
+	if ((1 == IsStopped(sched)) && (2 != flag))
 	{
 		SCHClearAll(sched);
-		
+
 		flag = 1;
 	}
-	
-	sched->to_exit = 0;
-	
+
+	__sync_fetch_and_and(&sched->is_in_run, 0);
+	__sync_lock_release(&sched->to_exit);
+
 	return (flag);
 }
@@ -1,9 +1,90 @@
 #ifndef SCHED_H_
 #define SCHED_H_
 
+#include <stddef.h> /* size_t */
 
+#include "uid.h" /* uid_type */
+#include "schtime.h" /* sched_time_t */
+#include "evloop.h" /* EV_IN, EV_OUT, EV_ERR */
+#include "schtask.h" /* sch_catch_up_t */
+
+/* threads:
+	the tasks belong to the thread of SCHRun while it runs, and to the thread
+	that created the scheduler otherwise (hand them over before SCHRun runs
+	in another thread). any other thread (and a func that runs on a worker)
+	can call SCHAdd, SCHAddInterval, SCHAddWithSlack, SCHAddDynamic,
+	SCHAddBatch, SCHRemove, SCHReschedule, SCHRescheduleAt, SCHAddFd,
+	SCHRemoveFd and SCHStop -
+	they send a request by a lock free queue, that SCHRun takes when it
+	starts and in every wake up.
+	the other functions are for the thread that the tasks belong to only */
 typedef struct sched sched_t;
 
+/* the data structure that stores the tasks */
+typedef enum
+{
+	SCH_BACKEND_HEAP,			/* pqueue on a heap - O(log n) add and run */
+	SCH_BACKEND_SORTED_LIST,	/* pqueue on a sorted list - O(n) add */
+	SCH_BACKEND_WHEEL			/* timing wheel - O(1) add, remove and expiry */
+} sched_backend_t;
+
+typedef struct sched_attr
+{
+	sched_backend_t backend;
+	sched_time_t wheel_tick;	/* the resolution of the timing wheel */
+	size_t prealloc;			/* tasks to allocate when the scheduler is
+									created - up to this count, adding a task
+									allocates nothing */
+	size_t workers;				/* threads that run the funcs of the tasks,
+									while the thread of SCHRun only keeps the
+									time (0 - the funcs run in SCHRun) */
+	const sched_clock_t *clock;	/* the source of time (NULL - the monotonic
+									clock, see SCHTimeNow). with a virtual
+									clock (see SCHClockInitVirtual) SCHRun
+									doesn't sleep - it moves the clock to the
+									next deadline, and there are no workers.
+									it must live as long as the scheduler */
+} sched_attr_t;
+
+/* the stats of the runs (the times are in nanoseconds, and the percentiles
+	are up to 6% above the real value) */
+typedef struct sched_stats
+{
+	sched_time_t lateness_p50;	/* the start of a run after its time */
+	sched_time_t lateness_p99;
+	sched_time_t lateness_max;
+	sched_time_t run_time_p50;	/* how long the func of a run took */
+	sched_time_t run_time_p99;
+	sched_time_t run_time_max;
+	size_t queue_depth;			/* the tasks in the scheduler now */
+	size_t runs;				/* the runs in the period */
+	size_t missed;				/* the runs in the period that the catch up
+									policies dropped */
+	double runs_per_sec;
+	sched_time_t period;		/* since the scheduler was created, or since
+									SCHResetStats */
+} sched_stats_t;
+
+/* the costs of a task in all its runs (in nanoseconds), for SCHGetTopTasks */
+typedef struct sched_task_cost
+{
+	uid_type uid;
+	void *arg;
+	size_t runs;
+	sched_time_t cpu_time;		/* the cpu time of the thread that ran it */
+	sched_time_t wall_time;
+	size_t missed;				/* the runs that its catch up policy dropped */
+} sched_task_cost_t;
+
+/* a task to add with SCHAddBatch */
+typedef struct sched_task_spec
+{
+	int (*func)(void *arg);
+	void *arg;
+	sched_time_t interval;		/* in nanoseconds */
+	sched_time_t slack;			/* see SCHAddWithSlack (0 - none) */
+} sched_task_spec_t;
+
 /********************************Functions*************************************/
 
 /* to create a new scheduler.
@@ -12,27 +93,137 @@ typedef struct sched sched_t;
 	(and if the malloc failled - returns NULL) */
 sched_t *SCHCreate(void);
 
+/* to init the attributes of a scheduler to the default values */
+void SCHAttrInit(sched_attr_t *attr);
+
+/* to create a new scheduler by given attributes.
+	returns a pointer to the new scheduler
+	(and if the malloc failled - returns NULL) */
+sched_t *SCHCreateWithAttr(const sched_attr_t *attr);
+
 /* to free the memory of the scheduler */
 void SCHDestroy (sched_t *sched);
 
 /* to remove a specific task from the scheduler.
+	from another thread, the task is removed in the next wake up of SCHRun,
+	and 0 means that the request was sent.
   returns 0 for success, and 1 if there is no task to remove */
 int SCHRemove(sched_t *sched, uid_type uid);
 
+/* to change the interval of a task, and run it 'interval' nanoseconds
+	from now (the uid stays the same, and nothing is allocated).
+	can be called from the task itself - then it reruns by the new time.
+	from another thread, the task is moved in the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 if there is no such task */
+int SCHReschedule(sched_t *sched, uid_type uid, sched_time_t interval);
+
+/* to run a task at the absolute time 'deadline' (on the clock of the
+	scheduler - SCHTimeNow by default), and then every its interval as before.
+	from another thread, the task is moved in the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 if there is no such task */
+int SCHRescheduleAt(sched_t *sched, uid_type uid, sched_time_t deadline);
+
+/* to set what a periodic task does with the runs that it missed after
+	a stall (SCH_CATCH_UP_ALL by default - every missed run, one after
+	the other).
+	returns 0 for success, and 1 if there is no such task */
+int SCHSetCatchUp(sched_t *sched, uid_type uid, sch_catch_up_t catch_up);
+
+/* to count the runs of a task that its catch up policy dropped.
+	returns 0 for success, and 1 if there is no such task */
+int SCHGetMissed(const sched_t *sched, uid_type uid, size_t *missed);
+
 /* to create a new task and add it to the scheduler.
+	the task runs every 'due_time' seconds.
 	returns the new uid of the task */
 uid_type SCHAdd(sched_t *sched, int (*func) (void *arg), void *arg, size_t due_time);
 
-/* to clear all the tasks of the scheduler */
+/* to create a new task and add it to the scheduler.
+	the task runs every 'interval' nanoseconds
+	(SCH_SEC, SCH_MSEC and SCH_USEC convert to nanoseconds).
+	from another thread, the task is added in the next wake up of SCHRun
+	(its uid is ready at once).
+	returns the new uid of the task */
+uid_type SCHAddInterval(sched_t *sched, int (*func) (void *arg), void *arg,
+						sched_time_t interval);
+
+/* to create a new task and add it to the scheduler, like SCHAddInterval.
+	every run can be up to 'slack' nanoseconds late, so the tasks that their
+	windows overlap run in one wake up (like the timer slack of the kernel).
+	returns the new uid of the task */
+uid_type SCHAddWithSlack(sched_t *sched, int (*func) (void *arg), void *arg,
+						 sched_time_t interval, sched_time_t slack);
+
+/* to create a new task that chooses its next run by itself, and add it to
+	the scheduler.
+	the task runs first after 'delay' nanoseconds (and 'slack', like
+	SCHAddWithSlack). 'func' gets 'arg' and a place for the next time
+	(its current interval), and returns:
+	-1 for failure and 0 for success (then the task is removed),
+	1 - to rerun after the same interval,
+	SCH_NEXT_AFTER - to rerun '*next' nanoseconds after the time that the run
+	was due at (the catch up policy of the task counts from there),
+	SCH_NEXT_AT - to rerun at the time '*next' (on the clock of the scheduler).
+	so a task can back off, or poll faster, without removing and adding it.
+	returns the new uid of the task */
+uid_type SCHAddDynamic(sched_t *sched, int (*func)(void *arg, sched_time_t *next),
+					   void *arg, sched_time_t delay, sched_time_t slack);
+
+/* to create 'count' tasks and add them to the scheduler at once
+	(O(n) for the heap and the wheel, one sort and merge for the list).
+	the uid of every task is written to 'uids' (can be NULL) by the order
+	of 'specs'.
+	from another thread, the tasks are added together in the next wake up
+	of SCHRun.
+	returns 0 for success, and 1 for failure (then no task is added) */
+int SCHAddBatch(sched_t *sched, const sched_task_spec_t *specs, size_t count,
+				uid_type *uids);
+
+/* to clear all the tasks of the scheduler
+	(and the tasks that other threads asked to add) */
 void SCHClearAll(sched_t *sched);
 
+/* to watch a file descriptor together with the tasks.
+	'func' is called from SCHRun when one of 'events' happens
+	(EV_IN, EV_OUT, EV_ERR), and it returns -1 for failure,
+	0 - success and stop watching, 1 - keep watching.
+	from another thread, the fd is watched from the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 for failure */
+int SCHAddFd(sched_t *sched, int fd, unsigned int events,
+			 int (*func)(int fd, unsigned int events, void *arg), void *arg);
+
+/* to stop watching a file descriptor.
+	from another thread, the fd is left in the next wake up of SCHRun,
+	and 0 means that the request was sent.
+	returns 0 for success, and 1 if the fd isn't watched */
+int SCHRemoveFd(sched_t *sched, int fd);
+
 /* to run a task at run time from the scheduler.
+	the scheduler runs while it has tasks or watched fds.
 	if all the tasks done - returns 0.
 	if the scheduler stopped - returns 1.
 	for any problem - return 2 */
 int SCHRun(sched_t *sched);
 
-/* to stop the scheduler from running */
+/* to get the stats of the runs since the scheduler was created
+	(or since SCHResetStats) */
+void SCHGetStats(const sched_t *sched, sched_stats_t *stats);
+
+/* to start the stats again from now */
+void SCHResetStats(sched_t *sched);
+
+/* to list the tasks that used the most cpu time in their runs, from the
+	most expensive (O(n * max)).
+	up to 'max' tasks are written to 'costs'.
+	returns the number of tasks that were written */
+size_t SCHGetTopTasks(const sched_t *sched, sched_task_cost_t *costs, size_t max);
+
+/* to stop the scheduler from running.
+	can be called from any thread, and from a signal handler -
+	a waiting scheduler wakes up at once */
 void SCHStop(sched_t *sched);
 
 /* to check how many tasks are in the scheduler */
@@ -0,0 +1,345 @@
+#define _GNU_SOURCE /* pthread_setaffinity_np, cpu_set_t */
+
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, calloc, free */
+#include <stdint.h> /* uint64_t */
+#include <unistd.h> /* write, close */
+#include <pthread.h> /* pthread_create, pthread_join, affinity, mutex, cond */
+#include <sys/eventfd.h> /* eventfd */
+
+#include "schgroup.h"
+
+typedef struct sch_shard
+{
+	pthread_t thread;
+	sched_group_t *group;
+	int cpu;
+	sched_t *sched;
+} sch_shard_t;
+
+struct sched_group
+{
+	sch_shard_t *shards;
+	size_t count;
+	sched_attr_t attr;
+	int stop_fd;			/* every scheduler watches it - it keeps SCHRun
+								waiting without tasks, and stops it */
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	size_t ready_count;		/* the threads that created their scheduler */
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+/* to find the cpu of a given index - the cpus that the process can run on
+	take turns.
+	returns the cpu, or -1 if the mask can't be read */
+static int CpuOf(size_t index)
+{
+	cpu_set_t set;
+	size_t count = 0;
+	int cpu = 0;
+
+	if (0 != pthread_getaffinity_np(pthread_self(), sizeof(set), &set))
+	{
+		return (-1);
+	}
+
+	index %= (size_t)CPU_COUNT(&set);
+
+	for (cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+	{
+		if (CPU_ISSET(cpu, &set))
+		{
+			if (index == count)
+			{
+				return (cpu);
+			}
+
+			++count;
+		}
+	}
+
+	return (-1);
+}
+
+/****************************************************************************/
+
+/* the func of the stop fd - it stays readable, so every scheduler sees it */
+static int OnStop(int fd, unsigned int events, void *sched)
+{
+	(void)fd;
+	(void)events;
+
+	SCHStop((sched_t *)sched);
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* the func of a run thread - it pins itself, creates its scheduler
+	(so its memory is touched first on its cpu) and runs it */
+static void *RunShard(void *arg)
+{
+	sch_shard_t *shard = (sch_shard_t *)arg;
+	sched_group_t *group = shard->group;
+	sched_t *sched = NULL;
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(shard->cpu, &set);
+
+	if (0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+	{
+		sched = SCHCreateWithAttr(&group->attr);
+	}
+
+	if ((NULL != sched) &&
+		(1 == SCHAddFd(sched, group->stop_fd, EV_IN, &OnStop, sched)))
+	{
+		SCHDestroy(sched); sched = NULL;
+	}
+
+	pthread_mutex_lock(&group->lock);
+	shard->sched = sched;
+	++group->ready_count;
+	pthread_cond_broadcast(&group->ready);
+	pthread_mutex_unlock(&group->lock);
+
+	/* the requests that were sent before it ran are taken when it starts */
+	if (NULL != sched)
+	{
+		SCHRun(sched);
+	}
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+/* to stop the first 'count' run threads, join them, and destroy their
+	schedulers */
+static void StopShards(sched_group_t *group, size_t count)
+{
+	uint64_t one = 1;
+	size_t i = 0;
+
+	if (0 > write(group->stop_fd, &one, sizeof(one)))
+	{
+		/* an eventfd that can't count one more is readable already */
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		pthread_join(group->shards[i].thread, NULL);
+
+		if (NULL != group->shards[i].sched)
+		{
+			SCHDestroy(group->shards[i].sched); group->shards[i].sched = NULL;
+		}
+	}
+}
+
+/****************************************************************************/
+
+static void FreeGroup(sched_group_t *group)
+{
+	close(group->stop_fd);
+	pthread_cond_destroy(&group->ready);
+	pthread_mutex_destroy(&group->lock);
+	free(group->shards); group->shards = NULL;
+	free(group); group = NULL;
+}
+
+/****************************************************************************/
+
+/* the function creates a group of 'count' schedulers (0 - one for every cpu
+	that the process can run on).
+	every scheduler has its own run thread, that is pinned to one cpu and
+	creates the scheduler there, so the timers of a scheduler stay in the
+	cache of its cpu. the schedulers run until the group is destroyed.
+	'attr' is for all of them (NULL - the default attributes). a virtual
+	clock would be moved by all the threads at once, so 'attr->clock' must
+	be NULL.
+	returns the group (or NULL if one of the creations failed, or there
+	is a clock in 'attr') */
+sched_group_t *SCHGroupCreate(size_t count, const sched_attr_t *attr)
+{
+	sched_group_t *new_group = NULL;
+	cpu_set_t set;
+	size_t started = 0;
+	size_t i = 0;
+	int is_failed = 0;
+
+	if ((NULL != attr) && (NULL != attr->clock))
+	{
+		return (NULL);
+	}
+
+	if (0 == count)
+	{
+		if (0 != pthread_getaffinity_np(pthread_self(), sizeof(set), &set))
+		{
+			return (NULL);
+		}
+
+		count = (size_t)CPU_COUNT(&set);
+	}
+
+	new_group = (sched_group_t *)malloc(sizeof(sched_group_t));
+	if (NULL == new_group)
+	{
+		return (NULL);
+	}
+
+	new_group->shards = (sch_shard_t *)calloc(count, sizeof(sch_shard_t));
+	new_group->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if ((NULL == new_group->shards) || (-1 == new_group->stop_fd))
+	{
+		if (-1 != new_group->stop_fd)
+		{
+			close(new_group->stop_fd);
+		}
+
+		free(new_group->shards); new_group->shards = NULL;
+		free(new_group); new_group = NULL;
+
+		return (NULL);
+	}
+
+	if (NULL == attr)
+	{
+		SCHAttrInit(&new_group->attr);
+	}
+	else
+	{
+		new_group->attr = *attr;
+	}
+
+	new_group->count = count;
+	new_group->ready_count = 0;
+	pthread_mutex_init(&new_group->lock, NULL);
+	pthread_cond_init(&new_group->ready, NULL);
+
+	for (started = 0; started < count; ++started)
+	{
+		new_group->shards[started].group = new_group;
+		new_group->shards[started].cpu = CpuOf(started);
+		new_group->shards[started].sched = NULL;
+
+		if ((-1 == new_group->shards[started].cpu) ||
+			(0 != pthread_create(&new_group->shards[started].thread, NULL,
+								 &RunShard, &new_group->shards[started])))
+		{
+			break;
+		}
+	}
+
+	/* to wait until every thread has its scheduler */
+	pthread_mutex_lock(&new_group->lock);
+	while (new_group->ready_count < started)
+	{
+		pthread_cond_wait(&new_group->ready, &new_group->lock);
+	}
+	pthread_mutex_unlock(&new_group->lock);
+
+	for (i = 0; i < started; ++i)
+	{
+		is_failed |= (NULL == new_group->shards[i].sched);
+	}
+
+	if ((started < count) || (1 == is_failed))
+	{
+		StopShards(new_group, started);
+		FreeGroup(new_group); new_group = NULL;
+
+		return (NULL);
+	}
+
+	return (new_group);
+}
+
+/****************************************************************************/
+
+/* to stop all the schedulers of the group, join their threads,
+	and free them with their tasks */
+void SCHGroupDestroy(sched_group_t *group)
+{
+	/* checking parameters */
+	assert(NULL != group);
+
+	StopShards(group, group->count);
+	FreeGroup(group); group = NULL;
+}
+
+/****************************************************************************/
+
+/* to count the schedulers of the group */
+size_t SCHGroupCount(const sched_group_t *group)
+{
+	/* checking parameters */
+	assert(NULL != group);
+
+	return (group->count);
+}
+
+/****************************************************************************/
+
+/* to get the scheduler of a given index (an explicit affinity).
+	it runs in another thread - see sched.h for the functions that can
+	be called on it */
+sched_t *SCHGroupGet(const sched_group_t *group, size_t index)
+{
+	/* checking parameters */
+	assert((NULL != group) && (index < group->count));
+
+	return (group->shards[index].sched);
+}
+
+/****************************************************************************/
+
+/* to get the index of the scheduler that a key goes to (by its hash).
+	the same key always goes to the same scheduler */
+size_t SCHGroupIndexOf(const sched_group_t *group, size_t key)
+{
+	unsigned long hash = 0;
+
+	/* checking parameters */
+	assert(NULL != group);
+
+	/* close keys (like pids) spread over all the schedulers */
+	hash = (unsigned long)key * 2654435761UL;
+	hash ^= (hash >> 15);
+
+	return ((size_t)(hash % group->count));
+}
+
+/****************************************************************************/
+
+/* to create a new task and add it to the scheduler of 'key'.
+	the task runs every 'interval' nanoseconds.
+	returns the new uid of the task */
+uid_type SCHGroupAdd(sched_group_t *group, size_t key,
+					 int (*func)(void *arg), void *arg, sched_time_t interval)
+{
+	/* checking parameters */
+	assert((NULL != group) && (NULL != func));
+
+	return (SCHAddInterval(SCHGroupGet(group, SCHGroupIndexOf(group, key)),
+						   func, arg, interval));
+}
+
+/****************************************************************************/
+
+/* to remove a task that was added with 'key'.
+	returns 0 if the request was sent, and 1 for failure */
+int SCHGroupRemove(sched_group_t *group, size_t key, uid_type uid)
+{
+	/* checking parameters */
+	assert(NULL != group);
+
+	return (SCHRemove(SCHGroupGet(group, SCHGroupIndexOf(group, key)), uid));
+}
@@ -0,0 +1,53 @@
+#ifndef SCHGROUP_H
+
+#define SCHGROUP_H
+
+#include <stddef.h> /* size_t */
+
+#include "uid.h" /* uid_type */
+#include "schtime.h" /* sched_time_t */
+#include "sched.h" /* sched_t, sched_attr_t */
+
+typedef struct sched_group sched_group_t;
+
+/************************Functions*************************************/
+
+/* the function creates a group of 'count' schedulers (0 - one for every cpu
+	that the process can run on).
+	every scheduler has its own run thread, that is pinned to one cpu and
+	creates the scheduler there, so the timers of a scheduler stay in the
+	cache of its cpu. the schedulers run until the group is destroyed.
+	'attr' is for all of them (NULL - the default attributes). a virtual
+	clock would be moved by all the threads at once, so 'attr->clock' must
+	be NULL.
+	returns the group (or NULL if one of the creations failed, or there
+	is a clock in 'attr') */
+sched_group_t *SCHGroupCreate(size_t count, const sched_attr_t *attr);
+
+/* to stop all the schedulers of the group, join their threads,
+	and free them with their tasks */
+void SCHGroupDestroy(sched_group_t *group);
+
+/* to count the schedulers of the group */
+size_t SCHGroupCount(const sched_group_t *group);
+
+/* to get the scheduler of a given index (an explicit affinity).
+	it runs in another thread - see sched.h for the functions that can
+	be called on it */
+sched_t *SCHGroupGet(const sched_group_t *group, size_t index);
+
+/* to get the index of the scheduler that a key goes to (by its hash).
+	the same key always goes to the same scheduler */
+size_t SCHGroupIndexOf(const sched_group_t *group, size_t key);
+
+/* to create a new task and add it to the scheduler of 'key'.
+	the task runs every 'interval' nanoseconds.
+	returns the new uid of the task */
+uid_type SCHGroupAdd(sched_group_t *group, size_t key,
+					 int (*func)(void *arg), void *arg, sched_time_t interval);
+
+/* to remove a task that was added with 'key'.
+	returns 0 if the request was sent, and 1 for failure */
+int SCHGroupRemove(sched_group_t *group, size_t key, uid_type uid);
+
+#endif /* SCHGROUP_H */
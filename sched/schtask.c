@@ -1,34 +1,67 @@
+#include <stddef.h> /* offsetof */
 #include <stdlib.h> /* malloc, free */
 #include <assert.h> /* assert */
 #include <unistd.h> /* getpid */
 #include <sys/time.h> /* timeval */
 
+#include "heap.h" /* HEAP_NO_INDEX */
+#include "pool.h"
 #include "schtask.h"
 
+/* the fields that the scheduler touches on every visit come first,
+	so a task is 64 bytes up to the interval, and the order of the store
+	reads only the first one.
+	a task is in one store at a time - a heap (by index) or a wheel */
 struct task
 {
-    uid_type uid;
+    sched_time_t deadline;		/* next_run + slack - the order of the store */
+    sched_time_t next_run;
+    union
+    {
+        size_t pq_index;
+        tw_node_t wheel_node;
+    } queue;
     int (*func)(void *);
     void *param;
-    size_t due_time;
-    time_t next_run;
+    sched_time_t interval;
+    sched_time_t slack;			/* how late it can run, to share a wake up */
+    int (*next_func)(void *, sched_time_t *);
+    sched_time_t next;			/* the next time that 'next_func' chose
+    								(its interval when the run began) */
+    int next_kind;				/* 1, SCH_NEXT_AFTER or SCH_NEXT_AT */
+    uid_type uid;
+    pool_t *pool;
+    const sched_clock_t *clock;
+    unsigned int state;
+    sch_catch_up_t catch_up;
+    size_t missed;				/* the runs that the catch up policy dropped */
+    sched_time_t due;			/* the time that the last run was due at */
+    sched_time_t lateness;		/* the start of the last run after 'due' */
+    sched_time_t run_time;		/* how long the last run took */
+    sched_time_t cpu_time;		/* the cpu time of the thread in the last run */
+    size_t runs;
+    sched_time_t total_wall;	/* the run time of all the runs */
+    sched_time_t total_cpu;		/* the cpu time of all the runs */
 };
 
 /*****************************************************************************/
 
 /* to create a new task.
-	the function gets a function to do at the time,
-	time (in seconds) to know when the task needs to run,
+	the function gets a function to do at the time (or NULL, for a task
+	that gets its func by SCHTaskSetNextFunc),
+	the interval (in nanoseconds) to know when the task needs to run,
 	and a parameter that needed to the func.
+	the task is taken from 'pool' (a pool of SCHTaskSize() objects),
+	or allocated by itself if 'pool' is NULL.
+	the times of the task are read from 'clock' (NULL - the monotonic clock).
 	returns a pointer to the task (if succeed), or a NULL pointer if failure */
-task_t *SCHTaskCreate(int (*func)(void *param), size_t due_time, void *param)
+task_t *SCHTaskCreate(int (*func)(void *param), sched_time_t interval, void *param,
+					  pool_t *pool, const sched_clock_t *clock)
 {
 	task_t *new_task = NULL;
 	
-	/* checking parameters */
-	assert(NULL != func);
-	
-	new_task = (task_t *)malloc(sizeof(task_t));
+	new_task = (NULL != pool) ? (task_t *)PoolAlloc(pool) :
+								(task_t *)malloc(sizeof(task_t));
 	if (NULL == new_task)
 	{
 		return (NULL);
@@ -38,25 +71,59 @@ task_t *SCHTaskCreate(int (*func)(void *param), size_t due_time, void *param)
 	new_task->uid = UIDCreate();
 	new_task->func = func;
 	new_task->param = param;
-	new_task->due_time = due_time;
-	new_task->next_run = (time_t)(due_time) + new_task->uid.time.tv_sec;
+	new_task->interval = interval;
+	new_task->next_run = SCHClockNow(clock) + interval;
+	new_task->slack = 0;
+	new_task->next_func = NULL;
+	new_task->next = 0;
+	new_task->next_kind = 1;
+	new_task->deadline = new_task->next_run;
+	new_task->queue.pq_index = HEAP_NO_INDEX;
+	new_task->pool = pool;
+	new_task->clock = clock;
+	new_task->state = 0;
+	new_task->catch_up = SCH_CATCH_UP_ALL;
+	new_task->missed = 0;
+	new_task->due = 0;
+	new_task->lateness = 0;
+	new_task->run_time = 0;
+	new_task->cpu_time = 0;
+	new_task->runs = 0;
+	new_task->total_wall = 0;
+	new_task->total_cpu = 0;
 	
 	return (new_task);
 }
 
 /*****************************************************************************/
 
-/* to destroy a task, by freeing the memory that was allocated */
+/* to destroy a task, by giving it back to its pool
+	(or freeing the memory that was allocated) */
 void SCHTaskDestroy(task_t *task)
 {
 	/* checking parameters */
 	assert(NULL != task);
 
+	if (NULL != task->pool)
+	{
+		PoolFree(task->pool, task); task = NULL;
+
+		return;
+	}
+
 	free(task); task = NULL;
 }
 
 /*****************************************************************************/
 
+/* to get the size of a task, for a pool of tasks */
+size_t SCHTaskSize(void)
+{
+	return (sizeof(task_t));
+}
+
+/*****************************************************************************/
+
 /* to get the uid of the task */
 uid_type SCHTaskGetUid(const task_t *task)
 {
@@ -68,8 +135,8 @@ uid_type SCHTaskGetUid(const task_t *task)
 
 /*****************************************************************************/
 
-/* to get the run time of a function */
-time_t SCHTaskGetNextCall(const task_t *task)
+/* to get the run time of a function (on the clock of the task, in nanoseconds) */
+sched_time_t SCHTaskGetNextCall(const task_t *task)
 {
 	/* checking parameters */
 	assert(NULL != task);
@@ -79,15 +146,18 @@ time_t SCHTaskGetNextCall(const task_t *task)
 
 /*****************************************************************************/
 
-/* to check if a task is before another by comparing their run time.
+/* to check if a task is before another by comparing their deadlines
+	(see SCHTaskGetDeadline).
 	(curr < new)  => return 1 */
 int SCHTaskIsBefore(const void *curr_task1, const void *new_task2, void *param)
 {
 	/* checking parameters */
 	assert((NULL != curr_task1) && (NULL != new_task2));
-	
-	return (SCHTaskGetNextCall((task_t *)curr_task1) < 
-										SCHTaskGetNextCall((task_t *)new_task2));
+
+	(void)param;
+
+	return (((const task_t *)curr_task1)->deadline <
+										((const task_t *)new_task2)->deadline);
 }
 
 /*****************************************************************************/
@@ -104,23 +174,345 @@ int SCHTaskIsMatch(const void *task, void *uid)
 
 /*****************************************************************************/
 
-/* to update the next run time of the function */
+/* to get the wheel node that is inside the task */
+tw_node_t *SCHTaskGetWheelNode(task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (&task->queue.wheel_node);
+}
+
+/*****************************************************************************/
+
+/* to get the task that holds a given wheel node */
+task_t *SCHTaskFromWheelNode(tw_node_t *node)
+{
+	/* checking parameters */
+	assert(NULL != node);
+
+	return ((task_t *)((char *)node - offsetof(task_t, queue.wheel_node)));
+}
+
+/*****************************************************************************/
+
+/* to get the place that a heap keeps the index of the task in */
+size_t *SCHTaskGetQueueIndex(void *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (&((task_t *)task)->queue.pq_index);
+}
+
+/*****************************************************************************/
+
+/* to update the next run time of the function - one interval after the
+	time it had to run.
+	if that time passed already, the catch up policy of the task decides
+	(the runs that weren't done are added to its missed runs) */
 void SCHTaskUpdateNextCall(task_t *task)
+{
+	sched_time_t now = 0;
+	sched_time_t late = 0;
+
+	/* checking parameters */
+	assert(NULL != task);
+
+	/* an absolute time that the func chose is taken as it is */
+	if (SCH_NEXT_AT == task->next_kind)
+	{
+		task->next_run = task->next;
+		task->deadline = task->next_run + task->slack;
+
+		return;
+	}
+
+	if (SCH_NEXT_AFTER == task->next_kind)
+	{
+		task->interval = task->next;
+	}
+
+	/* from the time it had to run - not from now, so the period doesn't drift */
+	task->next_run += task->interval;
+
+	if ((SCH_CATCH_UP_ALL != task->catch_up) && (0 < task->interval))
+	{
+		now = SCHClockNow(task->clock);
+	}
+
+	if ((0 < now) && (task->next_run <= now))
+	{
+		/* the slots that are due already, and it stays on the same slots */
+		late = (now - task->next_run) / task->interval + 1;
+
+		/* a run that started after its next slot (a stall before it) was
+			the one run for the slots it missed already */
+		if ((SCH_CATCH_UP_COALESCE == task->catch_up) &&
+			(task->due + task->lateness < task->next_run))
+		{
+			/* the last of them runs at once, for all of them */
+			task->next_run += (late - 1) * task->interval;
+			task->missed += (size_t)(late - 1);
+		}
+		else
+		{
+			/* the first slot after now */
+			task->next_run += late * task->interval;
+			task->missed += (size_t)late;
+		}
+	}
+
+	task->deadline = task->next_run + task->slack;
+}
+
+/*****************************************************************************/
+
+/* to set what the task does with the runs that it missed
+	(SCH_CATCH_UP_ALL by default) */
+void SCHTaskSetCatchUp(task_t *task, sch_catch_up_t catch_up)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	task->catch_up = catch_up;
+}
+
+/*****************************************************************************/
+
+/* to count the runs that the task missed, and that its catch up policy
+	didn't do */
+size_t SCHTaskGetMissed(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->missed);
+}
+
+/*****************************************************************************/
+
+/* to set the next run time of the function (on the clock of the task,
+	in nanoseconds) */
+void SCHTaskSetNextCall(task_t *task, sched_time_t next_call)
 {
 	/* checking parameters */
 	assert(NULL != task);
 
-	task->next_run += task->due_time;
+	task->next_run = next_call;
+	task->deadline = next_call + task->slack;
 }
 
 /*****************************************************************************/
 
-/* to run a function.
+/* to get the time that the function has to run by - its next run time and
+	its slack (on the clock of the task, in nanoseconds) */
+sched_time_t SCHTaskGetDeadline(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->deadline);
+}
+
+/*****************************************************************************/
+
+/* to set how late (in nanoseconds) the function can run after its next
+	run time, so it can share a wake up with other tasks */
+void SCHTaskSetSlack(task_t *task, sched_time_t slack)
+{
+	/* checking parameters */
+	assert((NULL != task) && (0 <= slack));
+
+	task->slack = slack;
+	task->deadline = task->next_run + slack;
+}
+
+/*****************************************************************************/
+
+/* to set the interval (in nanoseconds) of the function */
+void SCHTaskSetInterval(task_t *task, sched_time_t interval)
+{
+	/* checking parameters */
+	assert((NULL != task) && (0 <= interval));
+
+	task->interval = interval;
+}
+
+/*****************************************************************************/
+
+/* to make the task dynamic - its func chooses the next run by itself.
+	'func' gets the parameter of the task and a place for the next time,
+	and returns -1, 0, 1, SCH_NEXT_AFTER or SCH_NEXT_AT */
+void SCHTaskSetNextFunc(task_t *task, int (*func)(void *param, sched_time_t *next))
+{
+	/* checking parameters */
+	assert((NULL != task) && (NULL != func));
+
+	task->next_func = func;
+}
+
+/*****************************************************************************/
+
+/* to get the state of the task (SCH_TASK_RUNNING, ...) */
+unsigned int SCHTaskGetState(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->state);
+}
+
+/*****************************************************************************/
+
+/* to set the state of the task (SCH_TASK_RUNNING, ...) */
+void SCHTaskSetState(task_t *task, unsigned int state)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	task->state = state;
+}
+
+/*****************************************************************************/
+
+/* to mark a task as running (SCH_TASK_RUNNING), and keep the time that
+	it's due at and its interval - they can change while it runs.
+	it's done by the thread that owns the task, before a worker runs it,
+	so SCHTaskRun reads only what was kept here */
+void SCHTaskBeginRun(task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	task->state = SCH_TASK_RUNNING;
+	task->due = task->next_run;
+
+	/* the interval stays, unless a dynamic func chooses another time */
+	task->next = task->interval;
+}
+
+/*****************************************************************************/
+
+/* to mark a task as not running, and add its last run to its totals.
+	it's done by the thread that owns the task (not by a worker),
+	so the totals can be read there while the task runs */
+void SCHTaskEndRun(task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	task->state = 0;
+	++task->runs;
+	task->total_wall += task->run_time;
+	task->total_cpu += task->cpu_time;
+}
+
+/*****************************************************************************/
+
+/* to run a function (after SCHTaskBeginRun), and measure its lateness,
+	its run time and the cpu time of the thread that runs it.
+	the next time that a dynamic func chose is kept for
+	SCHTaskUpdateNextCall.
 	at exit: returns -1 for failure, 0 - success, 1 - success and rerun */
 int SCHTaskRun(task_t *task)
+{
+	sched_time_t start = 0;
+	sched_time_t cpu_start = 0;
+	int res = 0;
+
+	/* checking parameters */
+	assert(NULL != task);
+
+	start = SCHClockNow(task->clock);
+	cpu_start = SCHTimeThreadCpu();
+	task->lateness = start - task->due;
+
+	if (NULL == task->next_func)
+	{
+		res = task->func(task->param);
+	}
+	else
+	{
+		res = task->next_func(task->param, &task->next);
+		task->next_kind = ((SCH_NEXT_AFTER == res) || (SCH_NEXT_AT == res)) ? res : 1;
+
+		if ((SCH_NEXT_AFTER == res) && (0 > task->next))
+		{
+			task->next = 0;
+		}
+
+		res = (1 == task->next_kind) ? res : 1;
+	}
+
+	task->cpu_time = SCHTimeThreadCpu() - cpu_start;
+	task->run_time = SCHClockNow(task->clock) - start;
+
+	return (res);
+}
+
+/*****************************************************************************/
+
+/* to get how late the last run of the task started (in nanoseconds) */
+sched_time_t SCHTaskGetLateness(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->lateness);
+}
+
+/*****************************************************************************/
+
+/* to get how long the last run of the task took (in nanoseconds) */
+sched_time_t SCHTaskGetRunTime(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->run_time);
+}
+
+/*****************************************************************************/
+
+/* to get the parameter of the function */
+void *SCHTaskGetParam(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->param);
+}
+
+/*****************************************************************************/
+
+/* to count the runs of the task that ended */
+size_t SCHTaskGetRuns(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->runs);
+}
+
+/*****************************************************************************/
+
+/* to get the run time of all the runs that ended (in nanoseconds) */
+sched_time_t SCHTaskGetTotalWall(const task_t *task)
+{
+	/* checking parameters */
+	assert(NULL != task);
+
+	return (task->total_wall);
+}
+
+/*****************************************************************************/
+
+/* to get the cpu time of all the runs that ended (in nanoseconds) */
+sched_time_t SCHTaskGetTotalCpu(const task_t *task)
 {
 	/* checking parameters */
 	assert(NULL != task);
 
-	return (task->func(task->param));
+	return (task->total_cpu);
 }
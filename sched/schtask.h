@@ -3,26 +3,67 @@
 #define SCHTASK_H
 
 #include "uid.h"
+#include "schtime.h"
+#include "twheel.h"
+#include "pool.h"
 
 typedef struct task task_t;
 
+/* the state of a task while it's out of the store to run */
+enum
+{
+	SCH_TASK_RUNNING = 1,	/* its func runs (or waits for a worker) */
+	SCH_TASK_REMOVED = 2,	/* it was removed - destroy it when it returns */
+	SCH_TASK_MOVED = 4		/* it was rescheduled - it has its next time */
+};
+
+/* what a periodic task does with the runs that it missed (after a stall -
+	a stopped process, swap, or a long func before it) */
+typedef enum
+{
+	SCH_CATCH_UP_ALL,		/* to run all of them, one after the other */
+	SCH_CATCH_UP_COALESCE,	/* to run once for all of them (a run that was
+								late is that run), and then in the next slot */
+	SCH_CATCH_UP_SKIP		/* to skip them, and run in the next slot */
+} sch_catch_up_t;
+
+/* what the func of a dynamic task (see SCHTaskSetNextFunc) can return,
+	besides -1 for failure, 0 - success, and 1 - success and rerun */
+enum
+{
+	SCH_NEXT_AFTER = 2,		/* rerun '*next' nanoseconds after the time that
+								this run was due at (its new interval) */
+	SCH_NEXT_AT = 3			/* rerun at the time '*next' (on the clock of
+								the task) */
+};
+
 /* to create a new task.
-	the function gets a function to do at the time,
-	time (in seconds) to know when the task needs to run,
+	the function gets a function to do at the time (or NULL, for a task
+	that gets its func by SCHTaskSetNextFunc),
+	the interval (in nanoseconds) to know when the task needs to run,
 	and a parameter that needed to the func.
+	the task is taken from 'pool' (a pool of SCHTaskSize() objects),
+	or allocated by itself if 'pool' is NULL.
+	the times of the task are read from 'clock' (NULL - the monotonic clock).
 	returns a pointer to the task (if succeed), or a NULL pointer if failure */
-task_t *SCHTaskCreate(int (*func)(void *param), size_t due_time, void *param);
+task_t *SCHTaskCreate(int (*func)(void *param), sched_time_t interval, void *param,
+					  pool_t *pool, const sched_clock_t *clock);
 
-/* to destroy a task, by freeing the memory that was allocated */
+/* to destroy a task, by giving it back to its pool
+	(or freeing the memory that was allocated) */
 void SCHTaskDestroy(task_t *task);
 
+/* to get the size of a task, for a pool of tasks */
+size_t SCHTaskSize(void);
+
 /* to get the uid of the task */
 uid_type SCHTaskGetUid(const task_t *task);
 
-/* to get the run time of a function */
-time_t SCHTaskGetNextCall(const task_t *task);
+/* to get the run time of a function (on the clock of the task, in nanoseconds) */
+sched_time_t SCHTaskGetNextCall(const task_t *task);
 
-/* to check if a task is before another by comparing their run time.
+/* to check if a task is before another by comparing their deadlines
+	(see SCHTaskGetDeadline).
 	(curr < new)  => return 1 */
 int SCHTaskIsBefore(const void *curr_task1, const void *new_task2, void *param);
 
@@ -30,12 +71,90 @@ int SCHTaskIsBefore(const void *curr_task1, const void *new_task2, void *param);
 	returns 1 if match, else - 0 */
 int SCHTaskIsMatch(const void *uid, void *task);
 
-/* to update the next run time of the function */
+/* to get the wheel node that is inside the task */
+tw_node_t *SCHTaskGetWheelNode(task_t *task);
+
+/* to get the task that holds a given wheel node */
+task_t *SCHTaskFromWheelNode(tw_node_t *node);
+
+/* to get the place that a heap keeps the index of the task in */
+size_t *SCHTaskGetQueueIndex(void *task);
+
+/* to update the next run time of the function - one interval after the
+	time it had to run.
+	if that time passed already, the catch up policy of the task decides
+	(the runs that weren't done are added to its missed runs) */
 void SCHTaskUpdateNextCall(task_t *task);
 
-/* to run a function.
+/* to set what the task does with the runs that it missed
+	(SCH_CATCH_UP_ALL by default) */
+void SCHTaskSetCatchUp(task_t *task, sch_catch_up_t catch_up);
+
+/* to count the runs that the task missed, and that its catch up policy
+	didn't do */
+size_t SCHTaskGetMissed(const task_t *task);
+
+/* to set the next run time of the function (on the clock of the task,
+	in nanoseconds) */
+void SCHTaskSetNextCall(task_t *task, sched_time_t next_call);
+
+/* to get the time that the function has to run by - its next run time and
+	its slack (on the clock of the task, in nanoseconds) */
+sched_time_t SCHTaskGetDeadline(const task_t *task);
+
+/* to set how late (in nanoseconds) the function can run after its next
+	run time, so it can share a wake up with other tasks */
+void SCHTaskSetSlack(task_t *task, sched_time_t slack);
+
+/* to set the interval (in nanoseconds) of the function */
+void SCHTaskSetInterval(task_t *task, sched_time_t interval);
+
+/* to make the task dynamic - its func chooses the next run by itself.
+	'func' gets the parameter of the task and a place for the next time,
+	and returns -1, 0, 1, SCH_NEXT_AFTER or SCH_NEXT_AT */
+void SCHTaskSetNextFunc(task_t *task, int (*func)(void *param, sched_time_t *next));
+
+/* to get the state of the task (SCH_TASK_RUNNING, ...) */
+unsigned int SCHTaskGetState(const task_t *task);
+
+/* to set the state of the task (SCH_TASK_RUNNING, ...) */
+void SCHTaskSetState(task_t *task, unsigned int state);
+
+/* to mark a task as running (SCH_TASK_RUNNING), and keep the time that
+	it's due at and its interval - they can change while it runs.
+	it's done by the thread that owns the task, before a worker runs it,
+	so SCHTaskRun reads only what was kept here */
+void SCHTaskBeginRun(task_t *task);
+
+/* to mark a task as not running, and add its last run to its totals.
+	it's done by the thread that owns the task (not by a worker),
+	so the totals can be read there while the task runs */
+void SCHTaskEndRun(task_t *task);
+
+/* to run a function (after SCHTaskBeginRun), and measure its lateness,
+	its run time and the cpu time of the thread that runs it.
+	the next time that a dynamic func chose is kept for
+	SCHTaskUpdateNextCall.
 	at exit: returns -1 for failure, 0 - success, 1 - success and rerun */
 int SCHTaskRun(task_t *task);
 
+/* to get how late the last run of the task started (in nanoseconds) */
+sched_time_t SCHTaskGetLateness(const task_t *task);
+
+/* to get how long the last run of the task took (in nanoseconds) */
+sched_time_t SCHTaskGetRunTime(const task_t *task);
+
+/* to get the parameter of the function */
+void *SCHTaskGetParam(const task_t *task);
+
+/* to count the runs of the task that ended */
+size_t SCHTaskGetRuns(const task_t *task);
+
+/* to get the run time of all the runs that ended (in nanoseconds) */
+sched_time_t SCHTaskGetTotalWall(const task_t *task);
+
+/* to get the cpu time of all the runs that ended (in nanoseconds) */
+sched_time_t SCHTaskGetTotalCpu(const task_t *task);
+
 
 #endif /* SCHTASK_H */
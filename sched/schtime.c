@@ -0,0 +1,67 @@
+#define _POSIX_C_SOURCE 200112L /* clock_gettime */
+
+#include <time.h> /* clock_gettime */
+
+#include "schtime.h"
+
+/*****************************************************************************/
+
+static sched_time_t VirtualNow(void *time)
+{
+	return (*(sched_time_t *)time);
+}
+
+/*****************************************************************************/
+
+/* the virtual time never goes back */
+static void VirtualAdvance(void *time, sched_time_t to)
+{
+	if (to > *(sched_time_t *)time)
+	{
+		*(sched_time_t *)time = to;
+	}
+}
+
+/*****************************************************************************/
+
+/* to get the current time of the monotonic clock (in nanoseconds) */
+sched_time_t SCHTimeNow(void)
+{
+	struct timespec now = {0};
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (SCH_SEC(now.tv_sec) + now.tv_nsec);
+}
+
+/*****************************************************************************/
+
+/* to get the current time of a clock (NULL - the monotonic clock) */
+sched_time_t SCHClockNow(const sched_clock_t *clock)
+{
+	return ((NULL == clock) ? SCHTimeNow() : clock->now(clock->arg));
+}
+
+/*****************************************************************************/
+
+/* to init a virtual clock, that keeps its time in '*time'.
+	the time moves only by SCHRun (or by the user), so hours of a schedule
+	run as fast as the funcs do - and the same way on every run */
+void SCHClockInitVirtual(sched_clock_t *clock, sched_time_t *time)
+{
+	clock->now = &VirtualNow;
+	clock->advance = &VirtualAdvance;
+	clock->arg = time;
+}
+
+/*****************************************************************************/
+
+/* to get the cpu time that the calling thread used (in nanoseconds) */
+sched_time_t SCHTimeThreadCpu(void)
+{
+	struct timespec used = {0};
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &used);
+
+	return (SCH_SEC(used.tv_sec) + used.tv_nsec);
+}
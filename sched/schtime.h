@@ -0,0 +1,41 @@
+#ifndef SCHTIME_H
+
+#define SCHTIME_H
+
+#include <stdint.h> /* int64_t */
+
+/* time of the scheduler - nanoseconds on the monotonic clock */
+typedef int64_t sched_time_t;
+
+#define SCH_NSEC(ns) ((sched_time_t)(ns))
+#define SCH_USEC(us) ((sched_time_t)(us) * 1000)
+#define SCH_MSEC(ms) ((sched_time_t)(ms) * 1000000)
+#define SCH_SEC(sec) ((sched_time_t)(sec) * 1000000000)
+
+/* a source of time for a scheduler (see sched_attr_t) */
+typedef struct sched_clock
+{
+	sched_time_t (*now)(void *arg);		/* the current time (in nanoseconds) */
+	void (*advance)(void *arg, sched_time_t to);
+										/* NULL for a clock that moves by itself.
+											otherwise the clock is virtual -
+											instead of waiting for a deadline,
+											SCHRun moves the clock to it */
+	void *arg;
+} sched_clock_t;
+
+/* to get the current time of the monotonic clock (in nanoseconds) */
+sched_time_t SCHTimeNow(void);
+
+/* to get the current time of a clock (NULL - the monotonic clock) */
+sched_time_t SCHClockNow(const sched_clock_t *clock);
+
+/* to init a virtual clock, that keeps its time in '*time'.
+	the time moves only by SCHRun (or by the user), so hours of a schedule
+	run as fast as the funcs do - and the same way on every run */
+void SCHClockInitVirtual(sched_clock_t *clock, sched_time_t *time);
+
+/* to get the cpu time that the calling thread used (in nanoseconds) */
+sched_time_t SCHTimeThreadCpu(void);
+
+#endif /* SCHTIME_H */
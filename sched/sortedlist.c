@@ -11,10 +11,80 @@ struct sdlist
     int (* is_before)(const void* data1, const void *data2, void *param);
 };
 
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+static void SwapData(void **data1, void **data2)
+{
+	void *temp = *data1;
+
+	*data1 = *data2;
+	*data2 = temp;
+}
+
+/****************************************************************************/
+
+/* to move an item of an array heap down (the last by the order on top) */
+static void SiftDownData(const sdlist_t *s_dlist, void **data, size_t index,
+						 size_t count)
+{
+	size_t child = (2 * index) + 1;
+
+	while (child < count)
+	{
+		if ((child + 1 < count) &&
+			(1 == s_dlist->is_before(data[child], data[child + 1], s_dlist->param)))
+		{
+			++child;
+		}
+
+		if (0 == s_dlist->is_before(data[index], data[child], s_dlist->param))
+		{
+			break;
+		}
+
+		SwapData(&data[index], &data[child]);
+		index = child;
+		child = (2 * index) + 1;
+	}
+}
+
+/****************************************************************************/
+
+/* to sort an array by the order of the list, in place (heap sort) */
+static void SortData(const sdlist_t *s_dlist, void **data, size_t count)
+{
+	size_t i = 0;
+
+	for (i = count / 2; 0 < i; --i)
+	{
+		SiftDownData(s_dlist, data, i - 1, count);
+	}
+
+	for (i = count; 1 < i; --i)
+	{
+		SwapData(&data[0], &data[i - 1]);
+		SiftDownData(s_dlist, data, 0, i - 1);
+	}
+}
+
+/****************************************************************************/
+
 /* the function creates a new sorted list.
     the function creates also a node that is a dlist.
     returns the sorted list (or NULL if one of the allocation failed) */
 sdlist_t *SortedListCreate(is_before_t func, void *param)
+{
+	return (SortedListCreateWithPool(func, param, NULL));
+}
+
+/****************************************************************************/
+
+/* the function creates a new sorted list that takes its nodes from a pool
+	of DLNodeSize() objects (a NULL pool - every node is allocated by itself).
+    returns the sorted list (or NULL if one of the allocation failed) */
+sdlist_t *SortedListCreateWithPool(is_before_t func, void *param, pool_t *pool)
 {
 	sdlist_t *new_sdlist = NULL;
 	
@@ -28,7 +98,7 @@ sdlist_t *SortedListCreate(is_before_t func, void *param)
 	}
 	
 	/* to create the node dlist */
-	new_sdlist->dlist = DLCreate();
+	new_sdlist->dlist = DLCreateWithPool(pool);
 	if (NULL == new_sdlist->dlist)
 	{
 		free(new_sdlist); new_sdlist = NULL;
@@ -289,6 +359,82 @@ sdlist_info_t SortedListInsert(sdlist_t *s_dlist, const void *data)
 
 /****************************************************************************/
 
+/* to move an item to its place after its order changed.
+	the node itself is moved, so nothing is allocated.
+	returns the item */
+sdlist_info_t SortedListRelocate(sdlist_t *s_dlist, sdlist_info_t iter)
+{
+	sdlist_info_t find = {NULL};
+	void *data = NULL;
+
+    /* checking parameters */
+    assert((NULL != s_dlist) && (NULL != iter.info));
+
+	data = SortedListGetData(iter);
+	find = SortedListBegin(s_dlist);
+
+	/* the same search as insert, but the item itself is skipped */
+	while ((0 == SortedListIsSameIterator(find, SortedListEnd(s_dlist))) &&
+		   ((1 == SortedListIsSameIterator(find, iter)) ||
+		   (1 == s_dlist->is_before(SortedListGetData(find), data, s_dlist->param))))
+	{
+		find = SortedListNext(find);
+	}
+
+	/* if the item is already in its place */
+	if (1 == SortedListIsSameIterator(find, SortedListNext(iter)))
+	{
+		return (iter);
+	}
+
+	DLSplice((dlist_iterator_t)find.info, (dlist_iterator_t)iter.info,
+			 (dlist_iterator_t)SortedListNext(iter).info);
+
+	return (iter);
+}
+
+/****************************************************************************/
+
+/* to insert some items at once.
+	the array is sorted (its order is changed) and merged into the list
+	in one pass - O(n + k log k) instead of O(n * k).
+	returns 0 for success, and 1 if an allocation failed
+	(then only the first items by the order were inserted) */
+int SortedListInsertBatch(sdlist_t *s_dlist, void **data, size_t count)
+{
+	sdlist_info_t where = {NULL};
+	size_t i = 0;
+
+    /* checking parameters */
+    assert((NULL != s_dlist) && ((NULL != data) || (0 == count)));
+
+	SortData(s_dlist, data, count);
+
+	where = SortedListBegin(s_dlist);
+
+	for (i = 0; i < count; ++i)
+	{
+		/* the place of an item is after the place of the one before it */
+		while ((0 == SortedListIsSameIterator(where, SortedListEnd(s_dlist))) &&
+			   (1 == s_dlist->is_before(SortedListGetData(where), data[i],
+										s_dlist->param)))
+		{
+			where = SortedListNext(where);
+		}
+
+		if (1 == DLIsSameIterator(DLInsert((dlist_iterator_t)where.info,
+										   s_dlist->dlist, data[i]),
+								  DLEnd(s_dlist->dlist)))
+		{
+			return (1);
+		}
+	}
+
+	return (0);
+}
+
+/****************************************************************************/
+
 /* to merge two sorted lists to a long one.
 	insert every item from src to its place in dest.
 	returns pointer to dest */
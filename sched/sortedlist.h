@@ -4,6 +4,8 @@
 
 #include <stddef.h>
 
+#include "pool.h" /* pool_t */
+
 #ifndef DLIST_H
 #define DLIST_H
 
@@ -26,6 +28,11 @@ struct sdlist_info
     returns the sorted list (or NULL if one of the allocation failed) */
 sdlist_t *SortedListCreate(is_before_t func, void *param);
 
+/* the function creates a new sorted list that takes its nodes from a pool
+	of DLNodeSize() objects (a NULL pool - every node is allocated by itself).
+    returns the sorted list (or NULL if one of the allocation failed) */
+sdlist_t *SortedListCreateWithPool(is_before_t func, void *param, pool_t *pool);
+
 /* to destroy a sorted dlist */
 void SortedListDestroy(sdlist_t *s_dlist);
 
@@ -88,6 +95,18 @@ sdlist_info_t SortedListErase(sdlist_info_t item);
 	returns the new item, or the tail if failed */
 sdlist_info_t SortedListInsert(sdlist_t *s_dlist, const void *data);
 
+/* to move an item to its place after its order changed.
+	the node itself is moved, so nothing is allocated.
+	returns the item */
+sdlist_info_t SortedListRelocate(sdlist_t *s_dlist, sdlist_info_t item);
+
+/* to insert some items at once.
+	the array is sorted (its order is changed) and merged into the list
+	in one pass - O(n + k log k) instead of O(n * k).
+	returns 0 for success, and 1 if an allocation failed
+	(then only the first items by the order were inserted) */
+int SortedListInsertBatch(sdlist_t *s_dlist, void **data, size_t count);
+
 /* to merge two sorted lists to a long one.
 	insert every item from src to its place in dest.
 	returns pointer to dest */
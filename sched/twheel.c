@@ -0,0 +1,502 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, free */
+
+#include "twheel.h"
+
+/* 4 levels of 256 slots - the wheel covers 2^32 ticks, after that the nodes
+	wait in the overflow list */
+#define TW_BITS 8
+#define TW_SLOTS (1UL << TW_BITS)
+#define TW_MASK (TW_SLOTS - 1)
+#define TW_LEVELS 4
+
+#define TW_LEVEL_EXPIRED (-1)
+#define TW_LEVEL_OVERFLOW TW_LEVELS
+
+struct twheel
+{
+	tw_node_t slots[TW_LEVELS][TW_SLOTS];
+	size_t level_count[TW_LEVELS];
+	tw_node_t overflow;
+	tw_node_t expired;
+	unsigned long current;
+	size_t size;
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+/* every list has a dummy head, and it's circular */
+static void ListInit(tw_node_t *head)
+{
+	head->next = head;
+	head->prev = head;
+}
+
+/****************************************************************************/
+
+static int ListIsEmpty(const tw_node_t *head)
+{
+	return (head->next == head);
+}
+
+/****************************************************************************/
+
+static void ListPushBack(tw_node_t *head, tw_node_t *node)
+{
+	node->next = head;
+	node->prev = head->prev;
+
+	head->prev->next = node;
+	head->prev = node;
+}
+
+/****************************************************************************/
+
+static void ListUnlink(tw_node_t *node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+
+	node->next = NULL;
+	node->prev = NULL;
+}
+
+/****************************************************************************/
+
+/* to get the slot index of a tick in a given level */
+static size_t SlotIndex(unsigned long tick, int level)
+{
+	return ((tick >> (TW_BITS * level)) & TW_MASK);
+}
+
+/****************************************************************************/
+
+/* to put a node in its list, by the distance from the current tick */
+static void Place(twheel_t *wheel, tw_node_t *node)
+{
+	unsigned long delta = 0;
+	int level = 0;
+
+	if (node->expires <= wheel->current)
+	{
+		node->level = TW_LEVEL_EXPIRED;
+		ListPushBack(&wheel->expired, node);
+
+		return;
+	}
+
+	delta = node->expires - wheel->current;
+
+	for (level = 0; level < TW_LEVELS; ++level)
+	{
+		if ((delta >> (TW_BITS * level)) < TW_SLOTS)
+		{
+			node->level = level;
+			++wheel->level_count[level];
+			ListPushBack(&wheel->slots[level][SlotIndex(node->expires, level)],
+						 node);
+
+			return;
+		}
+	}
+
+	node->level = TW_LEVEL_OVERFLOW;
+	ListPushBack(&wheel->overflow, node);
+}
+
+/****************************************************************************/
+
+/* to take all the nodes out of a list, and put them again by the current tick.
+	the list is detached first - a node can go back to the same slot */
+static void Cascade(twheel_t *wheel, tw_node_t *head, int level)
+{
+	tw_node_t detached = {NULL};
+	tw_node_t *node = NULL;
+
+	if (1 == ListIsEmpty(head))
+	{
+		return;
+	}
+
+	detached.next = head->next;
+	detached.prev = head->prev;
+	detached.next->prev = &detached;
+	detached.prev->next = &detached;
+	ListInit(head);
+
+	while (0 == ListIsEmpty(&detached))
+	{
+		node = detached.next;
+		ListUnlink(node);
+
+		if (TW_LEVEL_OVERFLOW != level)
+		{
+			--wheel->level_count[level];
+		}
+
+		Place(wheel, node);
+	}
+}
+
+/****************************************************************************/
+
+/* to handle a new current tick - cascade the levels that wrapped,
+	and expire the nodes of the level 0 slot */
+static void Tick(twheel_t *wheel)
+{
+	int level = 0;
+	size_t index = 0;
+
+	for (level = 1; level <= TW_LEVELS; ++level)
+	{
+		/* a level cascades only when all the levels under it wrapped */
+		if (0 != SlotIndex(wheel->current, level - 1))
+		{
+			break;
+		}
+
+		if (TW_LEVELS == level)
+		{
+			Cascade(wheel, &wheel->overflow, TW_LEVEL_OVERFLOW);
+		}
+		else
+		{
+			index = SlotIndex(wheel->current, level);
+			Cascade(wheel, &wheel->slots[level][index], level);
+		}
+	}
+
+	index = SlotIndex(wheel->current, 0);
+	Cascade(wheel, &wheel->slots[0][index], 0);
+}
+
+/****************************************************************************/
+
+/* to move the wheel forward up to 'now'.
+	ticks that nothing can happen in are skipped */
+static void Advance(twheel_t *wheel, unsigned long now)
+{
+	unsigned long next = 0;
+	int level = 0;
+
+	while (wheel->current < now)
+	{
+		/* nothing can happen before the lowest level that has nodes cascades */
+		for (level = 0; (level < TW_LEVELS) && (0 == wheel->level_count[level]);
+			 ++level)
+		{
+			;
+		}
+
+		if (TW_LEVELS == level)
+		{
+			/* the wheel is empty - nothing to wait for */
+			if (1 == ListIsEmpty(&wheel->overflow))
+			{
+				wheel->current = now;
+
+				return;
+			}
+
+			level = TW_LEVELS - 1;
+		}
+
+		next = ((wheel->current >> (TW_BITS * level)) + 1) << (TW_BITS * level);
+		if (next > now)
+		{
+			wheel->current = now;
+
+			return;
+		}
+
+		wheel->current = next;
+		Tick(wheel);
+	}
+}
+
+/****************************************************************************/
+
+/* to find the first node in a list that matches the match func */
+static tw_node_t *ListFind(const tw_node_t *head, tw_match_t func, void *param)
+{
+	tw_node_t *node = NULL;
+
+	for (node = head->next; node != head; node = node->next)
+	{
+		if (1 == func(node, param))
+		{
+			return (node);
+		}
+	}
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+static void ListClear(tw_node_t *head, tw_free_t func)
+{
+	tw_node_t *node = NULL;
+
+	while (0 == ListIsEmpty(head))
+	{
+		node = head->next;
+		ListUnlink(node);
+
+		if (NULL != func)
+		{
+			func(node);
+		}
+	}
+}
+
+/****************************************************************************/
+
+/* the function creates a new hierarchical timing wheel.
+	the wheel counts time in ticks, and starts from 'now'.
+	returns the wheel (or NULL if the allocation failed) */
+twheel_t *TWCreate(unsigned long now)
+{
+	twheel_t *new_wheel = NULL;
+	int level = 0;
+	size_t index = 0;
+
+	new_wheel = (twheel_t *)malloc(sizeof(twheel_t));
+	if (NULL == new_wheel)
+	{
+		return (NULL);
+	}
+
+	for (level = 0; level < TW_LEVELS; ++level)
+	{
+		for (index = 0; index < TW_SLOTS; ++index)
+		{
+			ListInit(&new_wheel->slots[level][index]);
+		}
+
+		new_wheel->level_count[level] = 0;
+	}
+
+	ListInit(&new_wheel->overflow);
+	ListInit(&new_wheel->expired);
+
+	new_wheel->current = now;
+	new_wheel->size = 0;
+
+	return (new_wheel);
+}
+
+/****************************************************************************/
+
+/* to destroy a wheel (the nodes that are still in it are not freed) */
+void TWDestroy(twheel_t *wheel)
+{
+	/* checking parameters */
+	assert(NULL != wheel);
+
+	free(wheel); wheel = NULL;
+}
+
+/****************************************************************************/
+
+/* to count how many nodes are in the wheel */
+size_t TWSize(const twheel_t *wheel)
+{
+	/* checking parameters */
+	assert(NULL != wheel);
+
+	return (wheel->size);
+}
+
+/****************************************************************************/
+
+/* to check if the wheel is empty.
+	returns 1 if empty, 0 - otherwise */
+int TWIsEmpty(const twheel_t *wheel)
+{
+	/* checking parameters */
+	assert(NULL != wheel);
+
+	return (0 == wheel->size);
+}
+
+/****************************************************************************/
+
+/* to insert a node that expires at the tick 'expires' (O(1)).
+	if the tick already passed - the node is expired immediately */
+void TWInsert(twheel_t *wheel, tw_node_t *node, unsigned long expires)
+{
+	/* checking parameters */
+	assert((NULL != wheel) && (NULL != node));
+
+	node->expires = expires;
+	Place(wheel, node);
+
+	++wheel->size;
+}
+
+/****************************************************************************/
+
+/* to remove a node from the wheel (O(1)) */
+void TWRemove(twheel_t *wheel, tw_node_t *node)
+{
+	/* checking parameters */
+	assert((NULL != wheel) && (NULL != node) && (NULL != node->next));
+
+	if ((TW_LEVEL_EXPIRED != node->level) && (TW_LEVEL_OVERFLOW != node->level))
+	{
+		--wheel->level_count[node->level];
+	}
+
+	ListUnlink(node);
+
+	--wheel->size;
+}
+
+/****************************************************************************/
+
+/* to advance the wheel up to the tick 'now', and pop one of the nodes that
+	expired (amortized O(1)).
+	returns NULL if there is no expired node */
+tw_node_t *TWPopExpired(twheel_t *wheel, unsigned long now)
+{
+	tw_node_t *node = NULL;
+
+	/* checking parameters */
+	assert(NULL != wheel);
+
+	if (1 == ListIsEmpty(&wheel->expired))
+	{
+		Advance(wheel, now);
+	}
+
+	if (1 == ListIsEmpty(&wheel->expired))
+	{
+		return (NULL);
+	}
+
+	node = wheel->expired.next;
+	ListUnlink(node);
+
+	--wheel->size;
+
+	return (node);
+}
+
+/****************************************************************************/
+
+/* to get the tick that the wheel has to be advanced at.
+	it's never after the first expiry, but it can be before it
+	(when a higher level has to be cascaded).
+	the wheel must not be empty */
+unsigned long TWNextExpiry(const twheel_t *wheel)
+{
+	unsigned long next = 0;
+	unsigned long candidate = 0;
+	unsigned long base = 0;
+	const tw_node_t *node = NULL;
+	int level = 0;
+	size_t i = 0;
+
+	/* checking parameters */
+	assert((NULL != wheel) && (0 != wheel->size));
+
+	if (0 == ListIsEmpty(&wheel->expired))
+	{
+		return (wheel->current);
+	}
+
+	next = (unsigned long)-1;
+
+	/* the first full slot of every level - level 0 gives the exact tick,
+		the others give the tick that they are cascaded at */
+	for (level = 0; level < TW_LEVELS; ++level)
+	{
+		if (0 == wheel->level_count[level])
+		{
+			continue;
+		}
+
+		base = wheel->current >> (TW_BITS * level);
+
+		for (i = 1; i <= TW_SLOTS; ++i)
+		{
+			if (0 == ListIsEmpty(&wheel->slots[level][(base + i) & TW_MASK]))
+			{
+				candidate = (base + i) << (TW_BITS * level);
+				next = (candidate < next) ? candidate : next;
+
+				break;
+			}
+		}
+	}
+
+	for (node = wheel->overflow.next; node != &wheel->overflow; node = node->next)
+	{
+		next = (node->expires < next) ? node->expires : next;
+	}
+
+	return (next);
+}
+
+/****************************************************************************/
+
+/* to find the first node that matches the match func.
+	returns the node, or NULL if didn't find */
+tw_node_t *TWFind(const twheel_t *wheel, tw_match_t func, void *param)
+{
+	tw_node_t *found = NULL;
+	int level = 0;
+	size_t index = 0;
+
+	/* checking parameters */
+	assert((NULL != wheel) && (NULL != func));
+
+	found = ListFind(&wheel->expired, func, param);
+
+	for (level = 0; (NULL == found) && (level < TW_LEVELS); ++level)
+	{
+		for (index = 0; (NULL == found) && (index < TW_SLOTS); ++index)
+		{
+			found = ListFind(&wheel->slots[level][index], func, param);
+		}
+	}
+
+	if (NULL == found)
+	{
+		found = ListFind(&wheel->overflow, func, param);
+	}
+
+	return (found);
+}
+
+/****************************************************************************/
+
+/* to remove all the nodes from the wheel.
+	'func' is called for every removed node (if it's not NULL) */
+void TWClear(twheel_t *wheel, tw_free_t func)
+{
+	int level = 0;
+	size_t index = 0;
+
+	/* checking parameters */
+	assert(NULL != wheel);
+
+	ListClear(&wheel->expired, func);
+
+	for (level = 0; level < TW_LEVELS; ++level)
+	{
+		for (index = 0; index < TW_SLOTS; ++index)
+		{
+			ListClear(&wheel->slots[level][index], func);
+		}
+
+		wheel->level_count[level] = 0;
+	}
+
+	ListClear(&wheel->overflow, func);
+
+	wheel->size = 0;
+}
@@ -0,0 +1,67 @@
+#ifndef TWHEEL_H
+
+#define TWHEEL_H
+
+#include <stddef.h>
+
+typedef struct twheel twheel_t;
+typedef struct tw_node tw_node_t;
+
+/* the node of the wheel lives inside the user's struct (intrusive),
+	so inserting and removing never allocates.
+	the fields are for the wheel only - don't touch them */
+struct tw_node
+{
+	tw_node_t *next;
+	tw_node_t *prev;
+	unsigned long expires;
+	int level;
+};
+
+typedef int (*tw_match_t)(const tw_node_t *node, void *param);
+typedef void (*tw_free_t)(tw_node_t *node);
+
+/************************Functions*************************************/
+
+/* the function creates a new hierarchical timing wheel.
+	the wheel counts time in ticks, and starts from 'now'.
+	returns the wheel (or NULL if the allocation failed) */
+twheel_t *TWCreate(unsigned long now);
+
+/* to destroy a wheel (the nodes that are still in it are not freed) */
+void TWDestroy(twheel_t *wheel);
+
+/* to count how many nodes are in the wheel */
+size_t TWSize(const twheel_t *wheel);
+
+/* to check if the wheel is empty.
+	returns 1 if empty, 0 - otherwise */
+int TWIsEmpty(const twheel_t *wheel);
+
+/* to insert a node that expires at the tick 'expires' (O(1)).
+	if the tick already passed - the node is expired immediately */
+void TWInsert(twheel_t *wheel, tw_node_t *node, unsigned long expires);
+
+/* to remove a node from the wheel (O(1)) */
+void TWRemove(twheel_t *wheel, tw_node_t *node);
+
+/* to advance the wheel up to the tick 'now', and pop one of the nodes that
+	expired (amortized O(1)).
+	returns NULL if there is no expired node */
+tw_node_t *TWPopExpired(twheel_t *wheel, unsigned long now);
+
+/* to get the tick that the wheel has to be advanced at.
+	it's never after the first expiry, but it can be before it
+	(when a higher level has to be cascaded).
+	the wheel must not be empty */
+unsigned long TWNextExpiry(const twheel_t *wheel);
+
+/* to find the first node that matches the match func.
+	returns the node, or NULL if didn't find */
+tw_node_t *TWFind(const twheel_t *wheel, tw_match_t func, void *param);
+
+/* to remove all the nodes from the wheel.
+	'func' is called for every removed node (if it's not NULL) */
+void TWClear(twheel_t *wheel, tw_free_t func);
+
+#endif /* TWHEEL_H */
@@ -15,12 +15,11 @@ uid_type UIDCreate(void)
 	static size_t count = 1;
 	uid_type new_uid = {0};
 	
-	/* to initialize the fields in the struct */
+	/* to initialize the fields in the struct.
+		the counter is taken atomically, so any thread can create a uid */
 	new_uid.pid = getpid();
 	gettimeofday(&new_uid.time, NULL);
-	new_uid.counter = count;
-	
-	++count;
+	new_uid.counter = __sync_fetch_and_add(&count, 1);
 	
 	return (new_uid);
 }
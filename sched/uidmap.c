@@ -0,0 +1,284 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, calloc, free */
+
+#include "uidmap.h"
+
+#define UIDMAP_INIT_CAPACITY 16
+
+/* an empty slot has NULL data */
+typedef struct uidmap_slot
+{
+	uid_type uid;
+	void *data;
+} uidmap_slot_t;
+
+struct uidmap
+{
+	uidmap_slot_t *slots;
+	size_t capacity; 	/* always a power of 2 */
+	size_t size;
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+/* the counter is unique in a process, the pid mixes the processes */
+static size_t Hash(uid_type uid)
+{
+	unsigned long hash = ((unsigned long)uid.counter ^
+						  ((unsigned long)uid.pid << 16)) * 2654435761UL;
+
+	return ((size_t)(hash ^ (hash >> 15)));
+}
+
+/****************************************************************************/
+
+/* to find the slot of a uid, or the empty slot that ends its probe */
+static size_t Probe(const uidmap_t *map, uid_type uid)
+{
+	size_t mask = map->capacity - 1;
+	size_t index = Hash(uid) & mask;
+
+	while ((NULL != map->slots[index].data) &&
+		   (0 == UIDIsSame(map->slots[index].uid, uid)))
+	{
+		index = (index + 1) & mask;
+	}
+
+	return (index);
+}
+
+/****************************************************************************/
+
+/* to move all the uids to a new table of 'capacity' slots.
+	returns 0 for success, and 1 for failure */
+static int Rehash(uidmap_t *map, size_t capacity)
+{
+	uidmap_slot_t *old_slots = map->slots;
+	size_t old_capacity = map->capacity;
+	size_t i = 0;
+
+	map->slots = (uidmap_slot_t *)calloc(capacity, sizeof(uidmap_slot_t));
+	if (NULL == map->slots)
+	{
+		map->slots = old_slots;
+
+		return (1);
+	}
+
+	map->capacity = capacity;
+
+	for (i = 0; i < old_capacity; ++i)
+	{
+		if (NULL != old_slots[i].data)
+		{
+			map->slots[Probe(map, old_slots[i].uid)] = old_slots[i];
+		}
+	}
+
+	free(old_slots); old_slots = NULL;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* the function creates a new map from uids to data - an open addressed
+	hash table (linear probing), that grows when it's half full.
+	returns the map (or NULL if one of the allocation failed) */
+uidmap_t *UIDMapCreate(void)
+{
+	uidmap_t *new_map = (uidmap_t *)malloc(sizeof(uidmap_t));
+	if (NULL == new_map)
+	{
+		return (NULL);
+	}
+
+	new_map->slots = (uidmap_slot_t *)calloc(UIDMAP_INIT_CAPACITY,
+											 sizeof(uidmap_slot_t));
+	if (NULL == new_map->slots)
+	{
+		free(new_map); new_map = NULL;
+
+		return (NULL);
+	}
+
+	new_map->capacity = UIDMAP_INIT_CAPACITY;
+	new_map->size = 0;
+
+	return (new_map);
+}
+
+/****************************************************************************/
+
+/* to destroy a map (the data itself is not freed) */
+void UIDMapDestroy(uidmap_t *map)
+{
+	/* checking parameters */
+	assert(NULL != map);
+
+	free(map->slots); map->slots = NULL;
+	free(map); map = NULL;
+}
+
+/****************************************************************************/
+
+/* to count how many uids are in the map */
+size_t UIDMapSize(const uidmap_t *map)
+{
+	/* checking parameters */
+	assert(NULL != map);
+
+	return (map->size);
+}
+
+/****************************************************************************/
+
+/* to make sure that at least 'count' uids can be in the map
+	without allocation.
+	returns 0 for success, and 1 for failure */
+int UIDMapReserve(uidmap_t *map, size_t count)
+{
+	size_t capacity = 0;
+
+	/* checking parameters */
+	assert(NULL != map);
+
+	for (capacity = map->capacity; capacity < (2 * count); capacity *= 2)
+	{
+		/* empty */
+	}
+
+	return ((capacity == map->capacity) ? 0 : Rehash(map, capacity));
+}
+
+/****************************************************************************/
+
+/* to add a uid with its data (the uid must not be in the map,
+	and the data must not be NULL).
+	returns 0 for success, and 1 for failure */
+int UIDMapInsert(uidmap_t *map, uid_type uid, void *data)
+{
+	size_t index = 0;
+
+	/* checking parameters */
+	assert((NULL != map) && (NULL != data));
+
+	/* the map is kept at most half full, so the probes stay short */
+	if ((2 * (map->size + 1) > map->capacity) &&
+		(1 == Rehash(map, 2 * map->capacity)))
+	{
+		return (1);
+	}
+
+	index = Probe(map, uid);
+	assert(NULL == map->slots[index].data);
+
+	map->slots[index].uid = uid;
+	map->slots[index].data = data;
+	++map->size;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to find the data of a uid (O(1) on average).
+	returns the data, or NULL if the uid isn't in the map */
+void *UIDMapFind(const uidmap_t *map, uid_type uid)
+{
+	/* checking parameters */
+	assert(NULL != map);
+
+	return (map->slots[Probe(map, uid)].data);
+}
+
+/****************************************************************************/
+
+/* to remove a uid from the map (O(1) on average).
+	returns its data, or NULL if the uid isn't in the map */
+void *UIDMapRemove(uidmap_t *map, uid_type uid)
+{
+	size_t mask = 0;
+	size_t hole = 0;
+	size_t index = 0;
+	size_t home = 0;
+	void *data = NULL;
+
+	/* checking parameters */
+	assert(NULL != map);
+
+	mask = map->capacity - 1;
+	hole = Probe(map, uid);
+	data = map->slots[hole].data;
+	if (NULL == data)
+	{
+		return (NULL);
+	}
+
+	/* no tombstones - the next uids of the run move back into the hole,
+		if the hole is between their home slot and their place */
+	for (index = (hole + 1) & mask; NULL != map->slots[index].data;
+		 index = (index + 1) & mask)
+	{
+		home = Hash(map->slots[index].uid) & mask;
+
+		if (((index - home) & mask) >= ((index - hole) & mask))
+		{
+			map->slots[hole] = map->slots[index];
+			hole = index;
+		}
+	}
+
+	map->slots[hole].data = NULL;
+	--map->size;
+
+	return (data);
+}
+
+/****************************************************************************/
+
+/* to remove all the uids from the map */
+void UIDMapClear(uidmap_t *map)
+{
+	size_t i = 0;
+
+	/* checking parameters */
+	assert(NULL != map);
+
+	for (i = 0; i < map->capacity; ++i)
+	{
+		map->slots[i].data = NULL;
+	}
+
+	map->size = 0;
+}
+
+/****************************************************************************/
+
+/* to do a func on the data of every uid (in no order).
+	the map must not change while the func runs.
+	returns the value of the func if it stopped, 0 - otherwise */
+int UIDMapForEach(const uidmap_t *map, uidmap_do_t func, void *param)
+{
+	size_t i = 0;
+	int res = 0;
+
+	/* checking parameters */
+	assert((NULL != map) && (NULL != func));
+
+	for (i = 0; i < map->capacity; ++i)
+	{
+		if (NULL != map->slots[i].data)
+		{
+			res = func(map->slots[i].data, param);
+			if (0 != res)
+			{
+				return (res);
+			}
+		}
+	}
+
+	return (0);
+}
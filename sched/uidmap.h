@@ -0,0 +1,54 @@
+#ifndef UIDMAP_H
+
+#define UIDMAP_H
+
+#include <stddef.h>
+
+#include "uid.h" /* uid_type */
+
+typedef struct uidmap uidmap_t;
+
+/* a func to do on the data of every uid.
+	returns 0 to go on, and any other value to stop */
+typedef int (*uidmap_do_t)(void *data, void *param);
+
+/************************Functions*************************************/
+
+/* the function creates a new map from uids to data - an open addressed
+	hash table (linear probing), that grows when it's half full.
+	returns the map (or NULL if one of the allocation failed) */
+uidmap_t *UIDMapCreate(void);
+
+/* to destroy a map (the data itself is not freed) */
+void UIDMapDestroy(uidmap_t *map);
+
+/* to count how many uids are in the map */
+size_t UIDMapSize(const uidmap_t *map);
+
+/* to make sure that at least 'count' uids can be in the map
+	without allocation.
+	returns 0 for success, and 1 for failure */
+int UIDMapReserve(uidmap_t *map, size_t count);
+
+/* to add a uid with its data (the uid must not be in the map,
+	and the data must not be NULL).
+	returns 0 for success, and 1 for failure */
+int UIDMapInsert(uidmap_t *map, uid_type uid, void *data);
+
+/* to find the data of a uid (O(1) on average).
+	returns the data, or NULL if the uid isn't in the map */
+void *UIDMapFind(const uidmap_t *map, uid_type uid);
+
+/* to remove a uid from the map (O(1) on average).
+	returns its data, or NULL if the uid isn't in the map */
+void *UIDMapRemove(uidmap_t *map, uid_type uid);
+
+/* to remove all the uids from the map */
+void UIDMapClear(uidmap_t *map);
+
+/* to do a func on the data of every uid (in no order).
+	the map must not change while the func runs.
+	returns the value of the func if it stopped, 0 - otherwise */
+int UIDMapForEach(const uidmap_t *map, uidmap_do_t func, void *param);
+
+#endif /* UIDMAP_H */
@@ -0,0 +1,515 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, realloc, free */
+#include <pthread.h> /* pthread_create, pthread_join, mutex, cond */
+
+#include "wpool.h"
+
+#define WP_INIT_CAPACITY 16
+
+/* a ring of items.
+	the owner takes from the front - the oldest item, that is the latest
+	to its time - and a thief takes from the back.
+	the owner sleeps on the deque when it finds no item anywhere */
+typedef struct wp_deque
+{
+	pthread_mutex_t lock;
+	pthread_cond_t has_work;
+	void **items;
+	size_t head;
+	size_t count;
+	size_t capacity;
+	int is_waiting;			/* the owner sleeps on 'has_work' */
+	int is_woken;			/* the owner was woken to steal */
+	int to_exit;			/* the owner stops when the deque is empty */
+} wp_deque_t;
+
+typedef struct wp_done
+{
+	void *item;
+	int result;
+} wp_done_t;
+
+typedef struct wp_worker
+{
+	pthread_t thread;
+	wpool_t *pool;
+	size_t index;
+	wp_deque_t deque;
+} wp_worker_t;
+
+struct wpool
+{
+	wp_worker_t *workers;
+	size_t count;
+	size_t next;			/* the deque of the next submit */
+	size_t queued;			/* atomic - the items in all the deques */
+	pthread_mutex_t done_lock;
+	wp_done_t *done;
+	size_t done_head;
+	size_t done_count;
+	size_t done_capacity;
+	size_t outstanding;		/* items that were submitted and not taken back */
+	wp_run_t run;
+	wp_notify_t notify;
+	void *arg;
+};
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+/* to make room for one more item in a deque (its lock is held).
+	returns 0 for success, and 1 for failure */
+static int DequeGrow(wp_deque_t *deque)
+{
+	void **new_items = NULL;
+	size_t i = 0;
+
+	if (deque->count < deque->capacity)
+	{
+		return (0);
+	}
+
+	new_items = (void **)malloc(2 * deque->capacity * sizeof(void *));
+	if (NULL == new_items)
+	{
+		return (1);
+	}
+
+	/* the ring is straightened in the new array */
+	for (i = 0; i < deque->count; ++i)
+	{
+		new_items[i] = deque->items[(deque->head + i) % deque->capacity];
+	}
+
+	free(deque->items);
+	deque->items = new_items;
+	deque->head = 0;
+	deque->capacity *= 2;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to take the front item of a deque of 'pool'.
+	returns NULL if it's empty */
+static void *DequePopFront(wpool_t *pool, wp_deque_t *deque)
+{
+	void *item = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (0 < deque->count)
+	{
+		item = deque->items[deque->head];
+		deque->head = (deque->head + 1) % deque->capacity;
+		--deque->count;
+		__sync_fetch_and_sub(&pool->queued, 1);
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return (item);
+}
+
+/****************************************************************************/
+
+/* to take the back item of a deque of 'pool'.
+	returns NULL if it's empty */
+static void *DequePopBack(wpool_t *pool, wp_deque_t *deque)
+{
+	void *item = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (0 < deque->count)
+	{
+		--deque->count;
+		item = deque->items[(deque->head + deque->count) % deque->capacity];
+		__sync_fetch_and_sub(&pool->queued, 1);
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return (item);
+}
+
+/****************************************************************************/
+
+/* to find an item for a worker - from its own deque, or stolen from
+	the others (starting from the next one) */
+static void *FindItem(wp_worker_t *worker)
+{
+	wpool_t *pool = worker->pool;
+	void *item = NULL;
+	size_t i = 0;
+
+	item = DequePopFront(pool, &worker->deque);
+
+	for (i = 1; (NULL == item) && (i < pool->count); ++i)
+	{
+		item = DequePopBack(pool, &pool->workers[(worker->index + i) % pool->count].deque);
+	}
+
+	return (item);
+}
+
+/****************************************************************************/
+
+/* to wait on the deque of a worker until it has an item, or until the
+	worker is woken to steal.
+	an item that was submitted after FindItem looked, and before the worker
+	was waiting (so WakeThief passed it over), is counted in 'queued' - then
+	the worker looks again instead of sleeping.
+	returns 1 if the pool stops and the deque is empty, 0 - otherwise */
+static int WaitForWork(wp_worker_t *worker)
+{
+	wp_deque_t *deque = &worker->deque;
+	int is_exit = 0;
+
+	pthread_mutex_lock(&deque->lock);
+
+	while ((0 == deque->count) && (0 == deque->is_woken) && (0 == deque->to_exit) &&
+		   (0 == __sync_fetch_and_add(&worker->pool->queued, 0)))
+	{
+		deque->is_waiting = 1;
+		pthread_cond_wait(&deque->has_work, &deque->lock);
+		deque->is_waiting = 0;
+	}
+
+	deque->is_woken = 0;
+	is_exit = ((0 == deque->count) && (1 == deque->to_exit));
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return (is_exit);
+}
+
+/****************************************************************************/
+
+/* to wake one sleeping worker (besides 'except'), so it steals an item
+	that waits behind a busy worker */
+static void WakeThief(wpool_t *pool, size_t except)
+{
+	wp_deque_t *deque = NULL;
+	int is_woken = 0;
+	size_t i = 0;
+
+	for (i = 1; (0 == is_woken) && (i < pool->count); ++i)
+	{
+		deque = &pool->workers[(except + i) % pool->count].deque;
+
+		pthread_mutex_lock(&deque->lock);
+
+		if (1 == deque->is_waiting)
+		{
+			deque->is_woken = 1;
+			pthread_cond_signal(&deque->has_work);
+			is_woken = 1;
+		}
+
+		pthread_mutex_unlock(&deque->lock);
+	}
+}
+
+/****************************************************************************/
+
+static void *WorkerRoutine(void *arg)
+{
+	wp_worker_t *worker = (wp_worker_t *)arg;
+	wpool_t *pool = worker->pool;
+	void *item = NULL;
+	int result = 0;
+
+	while (1)
+	{
+		/* a worker that finds nothing sleeps on its own deque -
+			there is no lock that all the workers share */
+		item = FindItem(worker);
+		if (NULL == item)
+		{
+			if (1 == WaitForWork(worker))
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		result = pool->run(item);
+
+		/* the ring has room for every outstanding item (see WPSubmit) */
+		pthread_mutex_lock(&pool->done_lock);
+		pool->done[(pool->done_head + pool->done_count) % pool->done_capacity].item = item;
+		pool->done[(pool->done_head + pool->done_count) % pool->done_capacity].result = result;
+		++pool->done_count;
+		pthread_mutex_unlock(&pool->done_lock);
+
+		pool->notify(pool->arg);
+	}
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+/* to join the first 'count' workers.
+	a worker stops when its deque is empty, so the items that were
+	submitted run first */
+static void StopWorkers(wpool_t *pool, size_t count)
+{
+	wp_deque_t *deque = NULL;
+	size_t i = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		deque = &pool->workers[i].deque;
+
+		pthread_mutex_lock(&deque->lock);
+		deque->to_exit = 1;
+		pthread_cond_signal(&deque->has_work);
+		pthread_mutex_unlock(&deque->lock);
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+}
+
+/****************************************************************************/
+
+/* to free the memory of a pool after its workers stopped */
+static void FreePool(wpool_t *pool, size_t count)
+{
+	size_t i = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		pthread_mutex_destroy(&pool->workers[i].deque.lock);
+		pthread_cond_destroy(&pool->workers[i].deque.has_work);
+		free(pool->workers[i].deque.items); pool->workers[i].deque.items = NULL;
+	}
+
+	pthread_mutex_destroy(&pool->done_lock);
+
+	free(pool->done); pool->done = NULL;
+	free(pool->workers); pool->workers = NULL;
+	free(pool); pool = NULL;
+}
+
+/****************************************************************************/
+
+/* the function creates a pool of 'count' worker threads.
+	every worker has its own deque of items, and a worker that has
+	nothing to do steals items from the deques of the others, or sleeps
+	on its own deque (there is no lock that all the workers share).
+	returns the pool (or NULL if one of the creations failed) */
+wpool_t *WPCreate(size_t count, wp_run_t run, wp_notify_t notify, void *arg)
+{
+	wpool_t *new_pool = NULL;
+	size_t i = 0;
+
+	/* checking parameters */
+	assert((0 < count) && (NULL != run) && (NULL != notify));
+
+	new_pool = (wpool_t *)malloc(sizeof(wpool_t));
+	if (NULL == new_pool)
+	{
+		return (NULL);
+	}
+
+	new_pool->workers = (wp_worker_t *)malloc(count * sizeof(wp_worker_t));
+	new_pool->done = (wp_done_t *)malloc(WP_INIT_CAPACITY * sizeof(wp_done_t));
+	if ((NULL == new_pool->workers) || (NULL == new_pool->done))
+	{
+		free(new_pool->workers); new_pool->workers = NULL;
+		free(new_pool->done); new_pool->done = NULL;
+		free(new_pool); new_pool = NULL;
+
+		return (NULL);
+	}
+
+	new_pool->count = count;
+	new_pool->next = 0;
+	new_pool->queued = 0;
+	new_pool->done_head = 0;
+	new_pool->done_count = 0;
+	new_pool->done_capacity = WP_INIT_CAPACITY;
+	new_pool->outstanding = 0;
+	new_pool->run = run;
+	new_pool->notify = notify;
+	new_pool->arg = arg;
+
+	pthread_mutex_init(&new_pool->done_lock, NULL);
+
+	for (i = 0; i < count; ++i)
+	{
+		wp_worker_t *worker = &new_pool->workers[i];
+
+		worker->pool = new_pool;
+		worker->index = i;
+		worker->deque.head = 0;
+		worker->deque.count = 0;
+		worker->deque.capacity = WP_INIT_CAPACITY;
+		worker->deque.is_waiting = 0;
+		worker->deque.is_woken = 0;
+		worker->deque.to_exit = 0;
+		worker->deque.items = (void **)malloc(WP_INIT_CAPACITY * sizeof(void *));
+		pthread_mutex_init(&worker->deque.lock, NULL);
+		pthread_cond_init(&worker->deque.has_work, NULL);
+
+		if (NULL == worker->deque.items)
+		{
+			FreePool(new_pool, i + 1);
+
+			return (NULL);
+		}
+	}
+
+	/* a worker steals from all the deques, so they are ready before it starts */
+	for (i = 0; i < count; ++i)
+	{
+		if (0 != pthread_create(&new_pool->workers[i].thread, NULL, &WorkerRoutine,
+								&new_pool->workers[i]))
+		{
+			StopWorkers(new_pool, i);
+			FreePool(new_pool, count);
+
+			return (NULL);
+		}
+	}
+
+	return (new_pool);
+}
+
+/****************************************************************************/
+
+/* to destroy a pool.
+	the items that were submitted run first, and the workers are joined.
+	the items that are done and weren't taken are not freed */
+void WPDestroy(wpool_t *pool)
+{
+	/* checking parameters */
+	assert(NULL != pool);
+
+	StopWorkers(pool, pool->count);
+	FreePool(pool, pool->count);
+}
+
+/****************************************************************************/
+
+/* to give an item to the workers (the deques take turns).
+	returns 0 for success, and 1 for failure */
+int WPSubmit(wpool_t *pool, void *item)
+{
+	wp_deque_t *deque = NULL;
+	wp_done_t *new_done = NULL;
+	size_t index = 0;
+	size_t i = 0;
+	int is_waiting = 0;
+	int res = 0;
+
+	/* checking parameters */
+	assert((NULL != pool) && (NULL != item));
+
+	/* a worker never allocates - the done ring grows here, before the item
+		can be done */
+	pthread_mutex_lock(&pool->done_lock);
+
+	if (pool->outstanding == pool->done_capacity)
+	{
+		new_done = (wp_done_t *)malloc(2 * pool->done_capacity * sizeof(wp_done_t));
+		if (NULL == new_done)
+		{
+			pthread_mutex_unlock(&pool->done_lock);
+
+			return (1);
+		}
+
+		for (i = 0; i < pool->done_count; ++i)
+		{
+			new_done[i] = pool->done[(pool->done_head + i) % pool->done_capacity];
+		}
+
+		free(pool->done);
+		pool->done = new_done;
+		pool->done_head = 0;
+		pool->done_capacity *= 2;
+	}
+
+	++pool->outstanding;
+
+	pthread_mutex_unlock(&pool->done_lock);
+
+	index = pool->next;
+	deque = &pool->workers[index].deque;
+	pool->next = (pool->next + 1) % pool->count;
+
+	pthread_mutex_lock(&deque->lock);
+
+	res = DequeGrow(deque);
+	if (0 == res)
+	{
+		deque->items[(deque->head + deque->count) % deque->capacity] = item;
+		++deque->count;
+
+		/* counted before WakeThief looks for a waiting worker */
+		__sync_fetch_and_add(&pool->queued, 1);
+
+		/* the owner wakes up for its item */
+		is_waiting = deque->is_waiting;
+		if (1 == is_waiting)
+		{
+			pthread_cond_signal(&deque->has_work);
+		}
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	if (1 == res)
+	{
+		pthread_mutex_lock(&pool->done_lock);
+		--pool->outstanding;
+		pthread_mutex_unlock(&pool->done_lock);
+
+		return (1);
+	}
+
+	/* a busy owner gets to the item only after its run - a sleeping
+		worker steals it sooner */
+	if (0 == is_waiting)
+	{
+		WakeThief(pool, index);
+	}
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* to take an item that is done, with the result of its run.
+	returns the item, or NULL if no item is done */
+void *WPTakeDone(wpool_t *pool, int *result)
+{
+	void *item = NULL;
+
+	/* checking parameters */
+	assert((NULL != pool) && (NULL != result));
+
+	pthread_mutex_lock(&pool->done_lock);
+
+	if (0 < pool->done_count)
+	{
+		item = pool->done[pool->done_head].item;
+		*result = pool->done[pool->done_head].result;
+		pool->done_head = (pool->done_head + 1) % pool->done_capacity;
+		--pool->done_count;
+		--pool->outstanding;
+	}
+
+	pthread_mutex_unlock(&pool->done_lock);
+
+	return (item);
+}
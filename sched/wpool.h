@@ -0,0 +1,39 @@
+#ifndef WPOOL_H
+
+#define WPOOL_H
+
+#include <stddef.h>
+
+typedef struct wpool wpool_t;
+
+/* the func that runs an item on a worker thread.
+	its result is given back with the item by WPTakeDone */
+typedef int (*wp_run_t)(void *item);
+
+/* the func that is called on a worker thread after every item that is done
+	(to wake up the thread that takes the done items) */
+typedef void (*wp_notify_t)(void *arg);
+
+/************************Functions*************************************/
+
+/* the function creates a pool of 'count' worker threads.
+	every worker has its own deque of items, and a worker that has
+	nothing to do steals items from the deques of the others, or sleeps
+	on its own deque (there is no lock that all the workers share).
+	returns the pool (or NULL if one of the creations failed) */
+wpool_t *WPCreate(size_t count, wp_run_t run, wp_notify_t notify, void *arg);
+
+/* to destroy a pool.
+	the items that were submitted run first, and the workers are joined.
+	the items that are done and weren't taken are not freed */
+void WPDestroy(wpool_t *pool);
+
+/* to give an item to the workers (the deques take turns).
+	returns 0 for success, and 1 for failure */
+int WPSubmit(wpool_t *pool, void *item);
+
+/* to take an item that is done, with the result of its run.
+	returns the item, or NULL if no item is done */
+void *WPTakeDone(wpool_t *pool, int *result);
+
+#endif /* WPOOL_H */
@@ -0,0 +1,344 @@
+/******************************************************************************/
+/* 						   Scheduler - Benchmark			                  */
+/******************************************************************************/
+/* to build and run it (from the root of the repo):
+	gcc -std=gnu89 -O2 -iquote sched sched_bench.c sched/[a-z]*.c -o sched_bench -pthread -lrt
+	./sched_bench [max tasks (1000000)] [heap | list | wheel | all]
+
+	every line is one bench, on one distribution of deadlines and one
+	backend, with 10^2 up to 'max tasks' elements:
+	the throughput (operations per second), and the latency of one
+	operation in nanoseconds (p50/p99/max - with the reads of the clock
+	around it, so a few tens of nanoseconds are the clock).
+	the random deadlines come from a fixed seed, so every run is the same.
+	a sorted list takes O(n) to insert, so it runs up to BENCH_LIST_MAX */
+#define _GNU_SOURCE
+
+#include <stdio.h>			/* printf */
+#include <stdlib.h>			/* malloc, free, strtoul */
+#include <string.h>			/* strcmp */
+#include <stdint.h>			/* uint64_t, UINT64_C */
+
+#include "hist.h"			/* latency histograms */
+#include "pqueue.h"
+#include "sortedlist.h"
+#include "sched.h"
+
+#define BENCH_MIN 100
+#define BENCH_MAX 1000000
+#define BENCH_LIST_MAX 10000
+#define BENCH_SEED UINT64_C(88172645463325252)
+
+/* the deadlines are spread over BENCH_SPAN */
+#define BENCH_SPAN SCH_SEC(10)
+#define BENCH_CLUSTERS 16
+
+typedef enum
+{
+	DIST_UNIFORM,		/* anywhere in the span */
+	DIST_CLUSTERED,		/* in a few bursts of 1 ms */
+	DIST_PERIODIC,		/* a few periods, so many deadlines are the same */
+	DIST_COUNT
+} dist_t;
+
+typedef struct item
+{
+	sched_time_t deadline;
+	size_t index;
+} item_t;
+
+static const char *g_dist_names[DIST_COUNT] = {"uniform", "clustered", "periodic"};
+static uint64_t g_random = BENCH_SEED;
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+/* xorshift64 - the same numbers on every run */
+static uint64_t Random(void)
+{
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 7;
+	g_random ^= g_random << 17;
+
+	return (g_random);
+}
+
+/****************************************************************************/
+
+static void MakeDeadlines(sched_time_t *deadlines, size_t n, dist_t dist)
+{
+	static const sched_time_t periods[] = {SCH_MSEC(10), SCH_MSEC(50),
+										   SCH_MSEC(100), SCH_SEC(1), SCH_SEC(5)};
+	sched_time_t centers[BENCH_CLUSTERS];
+	size_t i = 0;
+
+	for (i = 0; i < BENCH_CLUSTERS; ++i)
+	{
+		centers[i] = (sched_time_t)(Random() % (uint64_t)BENCH_SPAN);
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		switch (dist)
+		{
+			case DIST_CLUSTERED:
+				deadlines[i] = centers[Random() % BENCH_CLUSTERS] +
+							   (sched_time_t)(Random() % (uint64_t)SCH_MSEC(1));
+				break;
+
+			case DIST_PERIODIC:
+				deadlines[i] = periods[Random() % (sizeof(periods) / sizeof(periods[0]))];
+				break;
+
+			default:
+				deadlines[i] = (sched_time_t)(Random() % (uint64_t)BENCH_SPAN);
+				break;
+		}
+	}
+}
+
+/****************************************************************************/
+
+static int ItemIsBefore(const void *item1, const void *item2, void *param)
+{
+	(void)param;
+
+	return (((const item_t *)item1)->deadline < ((const item_t *)item2)->deadline);
+}
+
+/****************************************************************************/
+
+static size_t *ItemIndex(void *item)
+{
+	return (&((item_t *)item)->index);
+}
+
+/****************************************************************************/
+
+static int Nothing(void *arg)
+{
+	(void)arg;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+static void Report(const char *bench, const char *backend, dist_t dist, size_t n,
+				   sched_time_t elapsed, const hist_t *latency)
+{
+	printf("%-12s %-6s %-10s %8lu %12.0f %8ld %8ld %10ld\n", bench, backend,
+		   g_dist_names[dist], (unsigned long)n,
+		   (0 < elapsed) ? ((double)n * SCH_SEC(1) / elapsed) : 0.0,
+		   (long)HistPercentile(latency, 50), (long)HistPercentile(latency, 99),
+		   (long)HistMax(latency));
+}
+
+/****************************************************************************/
+
+static void BenchPQ(pq_type_t type, const char *backend, item_t *items, size_t n,
+					dist_t dist, hist_t *latency)
+{
+	pqueue_t *pq = NULL;
+	sched_time_t start = 0;
+	sched_time_t before = 0;
+	size_t i = 0;
+
+	pq = PQCreate(&ItemIsBefore, NULL, type, (PQ_HEAP == type) ? &ItemIndex : NULL);
+	if (NULL == pq)
+	{
+		printf("PQCreate failed\n");
+
+		return;
+	}
+
+	HistClear(latency);
+	start = SCHTimeNow();
+	for (i = 0; i < n; ++i)
+	{
+		before = SCHTimeNow();
+		PQEnqueue(pq, &items[i]);
+		HistRecord(latency, SCHTimeNow() - before);
+	}
+	Report("PQEnqueue", backend, dist, n, SCHTimeNow() - start, latency);
+
+	HistClear(latency);
+	start = SCHTimeNow();
+	for (i = 0; i < n; ++i)
+	{
+		before = SCHTimeNow();
+		PQDequeue(pq);
+		HistRecord(latency, SCHTimeNow() - before);
+	}
+	Report("PQDequeue", backend, dist, n, SCHTimeNow() - start, latency);
+
+	PQDestroy(pq);
+}
+
+/****************************************************************************/
+
+static void BenchSortedList(item_t *items, size_t n, dist_t dist, hist_t *latency)
+{
+	sdlist_t *list = NULL;
+	sched_time_t start = 0;
+	sched_time_t before = 0;
+	size_t i = 0;
+
+	list = SortedListCreate(&ItemIsBefore, NULL);
+	if (NULL == list)
+	{
+		printf("SortedListCreate failed\n");
+
+		return;
+	}
+
+	HistClear(latency);
+	start = SCHTimeNow();
+	for (i = 0; i < n; ++i)
+	{
+		before = SCHTimeNow();
+		SortedListInsert(list, &items[i]);
+		HistRecord(latency, SCHTimeNow() - before);
+	}
+	Report("SLInsert", "list", dist, n, SCHTimeNow() - start, latency);
+
+	SortedListDestroy(list);
+}
+
+/****************************************************************************/
+
+static void BenchSched(sched_backend_t backend, const char *name,
+					   const sched_time_t *deadlines, uid_type *uids, size_t n,
+					   dist_t dist, hist_t *latency)
+{
+	sched_attr_t attr;
+	sched_t *sched = NULL;
+	sched_time_t start = 0;
+	sched_time_t before = 0;
+	uid_type temp = {0};
+	size_t i = 0;
+	size_t j = 0;
+
+	SCHAttrInit(&attr);
+	attr.backend = backend;
+
+	sched = SCHCreateWithAttr(&attr);
+	if (NULL == sched)
+	{
+		printf("SCHCreateWithAttr failed\n");
+
+		return;
+	}
+
+	HistClear(latency);
+	start = SCHTimeNow();
+	for (i = 0; i < n; ++i)
+	{
+		before = SCHTimeNow();
+		uids[i] = SCHAddInterval(sched, &Nothing, NULL, deadlines[i]);
+		HistRecord(latency, SCHTimeNow() - before);
+	}
+	Report("SCHAdd", name, dist, n, SCHTimeNow() - start, latency);
+
+	/* the tasks are removed in a random order */
+	for (i = n - 1; 0 < i; --i)
+	{
+		j = (size_t)(Random() % (i + 1));
+		temp = uids[i];
+		uids[i] = uids[j];
+		uids[j] = temp;
+	}
+
+	HistClear(latency);
+	start = SCHTimeNow();
+	for (i = 0; i < n; ++i)
+	{
+		before = SCHTimeNow();
+		SCHRemove(sched, uids[i]);
+		HistRecord(latency, SCHTimeNow() - before);
+	}
+	Report("SCHRemove", name, dist, n, SCHTimeNow() - start, latency);
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+	const char *backend = (2 < argc) ? argv[2] : "all";
+	size_t max = (1 < argc) ? (size_t)strtoul(argv[1], NULL, 10) : BENCH_MAX;
+	int is_heap = ((0 == strcmp(backend, "all")) || (0 == strcmp(backend, "heap")));
+	int is_list = ((0 == strcmp(backend, "all")) || (0 == strcmp(backend, "list")));
+	int is_wheel = ((0 == strcmp(backend, "all")) || (0 == strcmp(backend, "wheel")));
+	sched_time_t *deadlines = NULL;
+	item_t *items = NULL;
+	uid_type *uids = NULL;
+	hist_t *latency = NULL;
+	size_t n = 0;
+	size_t i = 0;
+	int dist = 0;
+
+	if ((0 == max) || (0 == (is_heap | is_list | is_wheel)))
+	{
+		printf("usage: %s [max tasks] [heap | list | wheel | all]\n", argv[0]);
+
+		return (1);
+	}
+
+	deadlines = (sched_time_t *)malloc(max * sizeof(sched_time_t));
+	items = (item_t *)malloc(max * sizeof(item_t));
+	uids = (uid_type *)malloc(max * sizeof(uid_type));
+	latency = HistCreate();
+	if ((NULL == deadlines) || (NULL == items) || (NULL == uids) || (NULL == latency))
+	{
+		printf("allocation failed\n");
+
+		return (1);
+	}
+
+	printf("%-12s %-6s %-10s %8s %12s %8s %8s %10s\n", "bench", "store", "deadlines",
+		   "n", "ops/s", "p50(ns)", "p99(ns)", "max(ns)");
+
+	for (n = BENCH_MIN; n <= max; n *= 10)
+	{
+		for (dist = 0; dist < DIST_COUNT; ++dist)
+		{
+			MakeDeadlines(deadlines, n, (dist_t)dist);
+
+			for (i = 0; i < n; ++i)
+			{
+				items[i].deadline = deadlines[i];
+			}
+
+			if (1 == is_heap)
+			{
+				BenchPQ(PQ_HEAP, "heap", items, n, (dist_t)dist, latency);
+				BenchSched(SCH_BACKEND_HEAP, "heap", deadlines, uids, n,
+						   (dist_t)dist, latency);
+			}
+
+			if ((1 == is_list) && (BENCH_LIST_MAX >= n))
+			{
+				BenchSortedList(items, n, (dist_t)dist, latency);
+				BenchPQ(PQ_SORTED_LIST, "list", items, n, (dist_t)dist, latency);
+				BenchSched(SCH_BACKEND_SORTED_LIST, "list", deadlines, uids, n,
+						   (dist_t)dist, latency);
+			}
+
+			if (1 == is_wheel)
+			{
+				BenchSched(SCH_BACKEND_WHEEL, "wheel", deadlines, uids, n,
+						   (dist_t)dist, latency);
+			}
+		}
+	}
+
+	HistDestroy(latency);
+	free(uids); uids = NULL;
+	free(items); items = NULL;
+	free(deadlines); deadlines = NULL;
+
+	return (0);
+}
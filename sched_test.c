@@ -0,0 +1,1693 @@
+/******************************************************************************/
+/* 						     Scheduler - Tests				                  */
+/******************************************************************************/
+/* to build and run it (from the root of the repo):
+	gcc -std=gnu89 -iquote sched sched_test.c sched/[a-z]*.c -o sched_test -pthread -lrt
+	./sched_test
+
+	the schedulers of the tests run on a virtual clock, so the times that
+	the tasks see are exact, and every run is the same.
+	every check that fails is printed, and the exit code is the number of
+	the failed checks */
+#define _GNU_SOURCE
+
+#include <stdio.h>			/* printf */
+#include <pthread.h>		/* pthread_create, pthread_join */
+#include <unistd.h>			/* pipe, read, write, close */
+
+#include "twheel.h"
+#include "uidmap.h"
+#include "mpscq.h"
+#include "wpool.h"
+#include "sched.h"
+#include "schgroup.h"
+
+#define TEST_WHEEL_NODES 12
+#define TEST_SEED 88172645UL
+
+/* a small map, that is kept under half full so it never grows -
+	its runs of uids are long, and a remove moves many of them */
+#define TEST_MAP_UIDS 64
+#define TEST_MAP_LIVE 7
+#define TEST_MAP_OPS 20000
+#define TEST_MAP_BIG 5000
+
+#define TEST_WORKERS 4
+#define TEST_WORK_ITEMS 10000
+#define TEST_BLOCKED (-1)		/* an item that runs until it's released */
+#define TEST_STEAL_WAIT_MS 2000
+
+#define TEST_PRODUCERS 4
+#define TEST_PUSHES 100000
+#define TEST_ADDS 200
+
+#define TEST_STALL_RUNS 4
+#define TEST_DYNAMIC_RUNS 6
+
+/* the tasks of a batch test, that their intervals are mixed by a step
+	that has no common factor with their count */
+#define TEST_BATCH_TASKS 104
+#define TEST_BATCH_STEP 37
+#define TEST_BATCH_THREAD 32
+
+#define TEST_TOP_TASKS 4		/* three costly tasks and the reporter */
+
+#define TEST_SHARDS 2
+#define TEST_SHARD_TASKS 8
+
+/* a task that checks the times of its runs */
+typedef struct timed
+{
+	const sched_time_t *time;	/* the virtual clock */
+	sched_time_t interval;
+	sched_time_t expected;		/* the time of the next run */
+	size_t runs;
+	size_t max_runs;			/* the task ends after them */
+	int is_late;				/* a run wasn't on its time */
+} timed_t;
+
+/* a task that removes other tasks of its batch, and then itself */
+typedef struct remover
+{
+	sched_t *sched;
+	uid_type victims[3];
+	uid_type self;
+	size_t runs;
+} remover_t;
+
+/* a node that a producer thread pushed */
+typedef struct pushed
+{
+	mpsc_node_t node;
+	size_t producer;
+	size_t seq;
+} pushed_t;
+
+typedef struct producer
+{
+	pthread_t thread;
+	mpscq_t *queue;
+	sched_t *sched;
+	pushed_t *nodes;
+	size_t index;
+} producer_t;
+
+/* a thread that watches pipes of a scheduler - the first one is left
+	before anything is written to it */
+typedef struct watched
+{
+	pthread_t thread;
+	sched_t *sched;
+	int pipes[2][2];
+	size_t reads[2];
+} watched_t;
+
+/* a periodic task that keeps the times of its runs, and can take
+	the clock forward in one of them (a long func) */
+typedef struct stalled
+{
+	sched_time_t *time;			/* the virtual clock */
+	sched_time_t runs_at[TEST_STALL_RUNS];
+	size_t runs;
+	size_t stall_run;			/* the run that takes long (0 - none) */
+	sched_time_t stall_to;
+} stalled_t;
+
+/* a task that chooses its next run by itself, and keeps the times of its runs */
+typedef struct dynamic
+{
+	sched_time_t *time;			/* the virtual clock */
+	sched_time_t runs_at[TEST_DYNAMIC_RUNS];
+	size_t runs;
+} dynamic_t;
+
+/* a task of a group, that keeps the thread that it ran on */
+typedef struct sharded
+{
+	pthread_t thread;
+	size_t *done;
+} sharded_t;
+
+/* a virtual clock that counts the times that SCHRun moved it (its wake ups) */
+typedef struct counted
+{
+	sched_time_t time;
+	size_t advances;
+} counted_t;
+
+/* a task that runs once, in its window of slack */
+typedef struct windowed
+{
+	const counted_t *clock;
+	sched_time_t ran_at;
+} windowed_t;
+
+/* a task that takes some cpu time in every run */
+typedef struct costly
+{
+	sched_time_t busy;
+	const int *is_done;
+} costly_t;
+
+/* the task that lists the most expensive tasks while they are there */
+typedef struct reporter
+{
+	sched_t *sched;
+	sched_task_cost_t costs[TEST_TOP_TASKS];
+	size_t count;
+	sched_task_cost_t all[TEST_TOP_TASKS + 1];
+	size_t all_count;
+	int is_done;
+} reporter_t;
+
+/* a task that moves itself and other tasks in its first run - one of its
+	batch, one to run sooner, and one to run later */
+typedef struct mover
+{
+	stalled_t log;
+	sched_t *sched;
+	uid_type self;
+	uid_type in_batch;
+	uid_type earlier;
+	uid_type later;
+} mover_t;
+
+static size_t g_failed = 0;
+static size_t g_added_runs = 0;
+static size_t g_batch_ids[TEST_BATCH_THREAD];
+static int g_is_in_order = 1;
+static int g_is_released = 0;
+static unsigned long g_random = TEST_SEED;
+
+/****************************************************************************/
+/* 			                Help Functions                                  */
+/****************************************************************************/
+
+static void Check(int is_ok, const char *what)
+{
+	if (0 == is_ok)
+	{
+		printf("FAILED: %s\n", what);
+		++g_failed;
+	}
+}
+
+/****************************************************************************/
+
+/* xorshift (32 bits) - the same numbers on every run */
+static unsigned long Random(void)
+{
+	g_random ^= (g_random << 13) & 0xffffffffUL;
+	g_random ^= g_random >> 17;
+	g_random ^= (g_random << 5) & 0xffffffffUL;
+
+	return (g_random);
+}
+
+/****************************************************************************/
+
+/* to check that every uid of 'uids' is found with its data, and only
+	the uids that are in the map.
+	returns 1 if they are, 0 - otherwise */
+static int IsMapSame(const uidmap_t *map, const uid_type *uids, char *data,
+					 const int *is_in, size_t count)
+{
+	size_t i = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		if (UIDMapFind(map, uids[i]) != ((1 == is_in[i]) ? &data[i] : NULL))
+		{
+			return (0);
+		}
+	}
+
+	return (1);
+}
+
+/****************************************************************************/
+
+static sched_t *CreateVirtual(sched_backend_t backend, sched_clock_t *clock,
+							  sched_time_t *time)
+{
+	sched_attr_t attr;
+
+	*time = 0;
+	SCHClockInitVirtual(clock, time);
+
+	SCHAttrInit(&attr);
+	attr.backend = backend;
+	attr.clock = clock;
+
+	return (SCHCreateWithAttr(&attr));
+}
+
+/****************************************************************************/
+
+static void InitTimed(timed_t *timed, const sched_time_t *time,
+					  sched_time_t interval, size_t max_runs)
+{
+	timed->time = time;
+	timed->interval = interval;
+	timed->expected = *time + interval;
+	timed->runs = 0;
+	timed->max_runs = max_runs;
+	timed->is_late = 0;
+}
+
+/****************************************************************************/
+
+static int RunTimed(void *arg)
+{
+	timed_t *timed = (timed_t *)arg;
+
+	timed->is_late |= (*timed->time != timed->expected);
+	timed->expected += timed->interval;
+	++timed->runs;
+
+	return (timed->runs < timed->max_runs);
+}
+
+/****************************************************************************/
+
+static int RunRemover(void *arg)
+{
+	remover_t *remover = (remover_t *)arg;
+	size_t i = 0;
+
+	++remover->runs;
+
+	if (3 == remover->runs)
+	{
+		for (i = 0; i < 3; ++i)
+		{
+			SCHRemove(remover->sched, remover->victims[i]);
+		}
+	}
+
+	/* a running task that is removed is destroyed when it returns */
+	if (5 == remover->runs)
+	{
+		SCHRemove(remover->sched, remover->self);
+	}
+
+	return (1);
+}
+
+/* the func of the workers - an item is a counter of its runs */
+static int RunItem(void *item)
+{
+	return (__sync_add_and_fetch((int *)item, 1));
+}
+
+/****************************************************************************/
+
+/* the func of the workers, with an item that keeps its worker busy */
+static int RunBlocking(void *item)
+{
+	if (TEST_BLOCKED == *(int *)item)
+	{
+		while (0 == __sync_fetch_and_add(&g_is_released, 0))
+		{
+			;
+		}
+	}
+
+	return (__sync_add_and_fetch((int *)item, 1));
+}
+
+/****************************************************************************/
+
+static void CountDone(void *done)
+{
+	__sync_fetch_and_add((size_t *)done, 1);
+}
+
+/****************************************************************************/
+
+static void *PushAll(void *arg)
+{
+	producer_t *producer = (producer_t *)arg;
+	size_t i = 0;
+
+	for (i = 0; i < TEST_PUSHES; ++i)
+	{
+		producer->nodes[i].producer = producer->index;
+		producer->nodes[i].seq = i;
+		MPSCPush(producer->queue, &producer->nodes[i].node);
+	}
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+static int RunOnce(void *arg)
+{
+	(void)arg;
+
+	__sync_fetch_and_add(&g_added_runs, 1);
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* a thread that adds tasks to a running scheduler, and removes every
+	other one before it runs */
+static void *AddAll(void *arg)
+{
+	producer_t *producer = (producer_t *)arg;
+	uid_type uid;
+	size_t i = 0;
+
+	for (i = 0; i < TEST_ADDS; ++i)
+	{
+		uid = SCHAddInterval(producer->sched, &RunOnce, NULL,
+							 (0 == (i % 2)) ? 0 : SCH_SEC(60));
+
+		if (1 == (i % 2))
+		{
+			SCHRemove(producer->sched, uid);
+		}
+	}
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+/* a task of a batch that another thread added - they run by their ids */
+static int RunInOrder(void *arg)
+{
+	g_is_in_order &= (*(size_t *)arg == g_added_runs);
+	__sync_fetch_and_add(&g_added_runs, 1);
+
+	return (0);
+}
+
+/****************************************************************************/
+
+/* a thread that adds a batch to a running scheduler, in the reverse order
+	of their times */
+static void *AddBatchAll(void *arg)
+{
+	producer_t *producer = (producer_t *)arg;
+	sched_task_spec_t specs[TEST_BATCH_THREAD];
+	size_t i = 0;
+
+	for (i = 0; i < TEST_BATCH_THREAD; ++i)
+	{
+		g_batch_ids[i] = TEST_BATCH_THREAD - 1 - i;
+		specs[i].func = &RunInOrder;
+		specs[i].arg = &g_batch_ids[i];
+		specs[i].interval = SCH_MSEC(g_batch_ids[i] + 1);
+		specs[i].slack = 0;
+	}
+
+	Check(0 == SCHAddBatch(producer->sched, specs, TEST_BATCH_THREAD, NULL),
+		  "batch from another thread - SCHAddBatch");
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+/* the task that keeps the scheduler running until the tasks of the other
+	threads ran */
+static int RunKeeper(void *arg)
+{
+	return (__sync_fetch_and_add(&g_added_runs, 0) < *(size_t *)arg);
+}
+
+/****************************************************************************/
+
+static int OnReadable(int fd, unsigned int events, void *arg)
+{
+	watched_t *watched = (watched_t *)arg;
+	char byte = 0;
+
+	(void)events;
+
+	++watched->reads[fd == watched->pipes[1][0]];
+
+	return ((1 == read(fd, &byte, 1)) ? 0 : -1);
+}
+
+/****************************************************************************/
+
+static void *WatchPipes(void *arg)
+{
+	watched_t *watched = (watched_t *)arg;
+	char byte = 0;
+
+	SCHAddFd(watched->sched, watched->pipes[0][0], EV_IN, &OnReadable, watched);
+	SCHRemoveFd(watched->sched, watched->pipes[0][0]);
+	SCHAddFd(watched->sched, watched->pipes[1][0], EV_IN, &OnReadable, watched);
+
+	if ((1 != write(watched->pipes[0][1], &byte, 1)) ||
+		(1 != write(watched->pipes[1][1], &byte, 1)))
+	{
+		Check(0, "write to a pipe");
+	}
+
+	return (NULL);
+}
+
+/****************************************************************************/
+
+/* the task that keeps the scheduler running until the pipe was read */
+static int RunUntilRead(void *arg)
+{
+	return (0 == ((watched_t *)arg)->reads[1]);
+}
+
+/****************************************************************************/
+
+static int RunSharded(void *arg)
+{
+	sharded_t *sharded = (sharded_t *)arg;
+
+	sharded->thread = pthread_self();
+	__sync_fetch_and_add(sharded->done, 1);
+
+	return (0);
+}
+
+/****************************************************************************/
+
+static int RunCostly(void *arg)
+{
+	costly_t *costly = (costly_t *)arg;
+	sched_time_t start = SCHTimeThreadCpu();
+
+	while (SCHTimeThreadCpu() - start < costly->busy)
+	{
+		;
+	}
+
+	return (0 == *costly->is_done);
+}
+
+/****************************************************************************/
+
+static int RunReporter(void *arg)
+{
+	reporter_t *reporter = (reporter_t *)arg;
+
+	reporter->count = SCHGetTopTasks(reporter->sched, reporter->costs, 2);
+	reporter->all_count = SCHGetTopTasks(reporter->sched, reporter->all,
+										 TEST_TOP_TASKS + 1);
+	reporter->is_done = 1;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+static sched_time_t CountedNow(void *clock)
+{
+	return (((counted_t *)clock)->time);
+}
+
+/****************************************************************************/
+
+static void CountedAdvance(void *clock, sched_time_t to)
+{
+	counted_t *counted = (counted_t *)clock;
+
+	if (to > counted->time)
+	{
+		counted->time = to;
+	}
+
+	++counted->advances;
+}
+
+/****************************************************************************/
+
+static int RunWindowed(void *arg)
+{
+	windowed_t *windowed = (windowed_t *)arg;
+
+	windowed->ran_at = windowed->clock->time;
+
+	return (0);
+}
+
+/****************************************************************************/
+
+static int RunStalled(void *arg)
+{
+	stalled_t *stalled = (stalled_t *)arg;
+
+	stalled->runs_at[stalled->runs] = *stalled->time;
+	++stalled->runs;
+
+	if (stalled->runs == stalled->stall_run)
+	{
+		*stalled->time = stalled->stall_to;
+	}
+
+	return (stalled->runs < TEST_STALL_RUNS);
+}
+
+/****************************************************************************/
+
+/* backs off after 2, 4 and 8 ms, then runs at 20 ms, once more after
+	the same interval (8 ms), and ends */
+static int RunDynamic(void *arg, sched_time_t *next)
+{
+	dynamic_t *dynamic = (dynamic_t *)arg;
+	int res = SCH_NEXT_AFTER;
+
+	dynamic->runs_at[dynamic->runs] = *dynamic->time;
+	++dynamic->runs;
+
+	switch (dynamic->runs)
+	{
+		case 1:
+		case 2:
+		case 3:
+			*next = SCH_MSEC(1) << dynamic->runs;
+			break;
+
+		case 4:
+			*next = SCH_MSEC(20);
+			res = SCH_NEXT_AT;
+			break;
+
+		case 5:
+			res = 1;
+			break;
+
+		default:
+			res = 0;
+			break;
+	}
+
+	return (res);
+}
+
+/****************************************************************************/
+
+/* like RunStalled, but the run that takes long asks to rerun 10 ms after
+	it was due, and the next run ends the task */
+static int RunLateDynamic(void *arg, sched_time_t *next)
+{
+	stalled_t *stalled = (stalled_t *)arg;
+
+	stalled->runs_at[stalled->runs] = *stalled->time;
+	++stalled->runs;
+
+	if (stalled->runs != stalled->stall_run)
+	{
+		return (0);
+	}
+
+	*stalled->time = stalled->stall_to;
+	*next = SCH_MSEC(10);
+
+	return (SCH_NEXT_AFTER);
+}
+
+/****************************************************************************/
+
+/* a task that stops the whole process for a while - it takes the clock
+	forward before the others run */
+static int RunStall(void *arg)
+{
+	stalled_t *stalled = (stalled_t *)arg;
+
+	*stalled->time = stalled->stall_to;
+
+	return (0);
+}
+
+static int RunMover(void *arg)
+{
+	mover_t *mover = (mover_t *)arg;
+
+	if (0 == mover->log.runs)
+	{
+		/* the mover itself keeps its new time when it returns */
+		Check(0 == SCHReschedule(mover->sched, mover->self, SCH_MSEC(30)),
+			  "reschedule - the running task");
+		Check(0 == SCHRescheduleAt(mover->sched, mover->in_batch, SCH_MSEC(25)),
+			  "reschedule - a task that waits in the batch");
+		Check(0 == SCHRescheduleAt(mover->sched, mover->earlier, SCH_MSEC(15)),
+			  "reschedule - a task to run sooner");
+		Check(0 == SCHReschedule(mover->sched, mover->later, SCH_MSEC(50)),
+			  "reschedule - a task to run later");
+	}
+
+	return (RunStalled(&mover->log));
+}
+
+/****************************************************************************/
+
+/* a periodic task that only keeps the times of its runs */
+static void InitLog(stalled_t *log, sched_time_t *time)
+{
+	log->time = time;
+	log->runs = 0;
+	log->stall_run = 0;
+	log->stall_to = 0;
+}
+
+/****************************************************************************/
+
+/* returns 1 if all the runs of 'log' were every 'interval' from 'first' */
+static int IsEvery(const stalled_t *log, sched_time_t first, sched_time_t interval)
+{
+	size_t i = 0;
+
+	for (i = 0; i < TEST_STALL_RUNS; ++i)
+	{
+		if (log->runs_at[i] != first + (sched_time_t)i * interval)
+		{
+			return (0);
+		}
+	}
+
+	return (TEST_STALL_RUNS == log->runs);
+}
+
+/****************************************************************************/
+/* 			                	Tests                                         */
+/****************************************************************************/
+
+/* every level of the wheel, and the overflow after it - a node pops at its
+	tick exactly, after it cascades down the levels */
+static void TestWheelCascade(void)
+{
+	static const unsigned long expires[TEST_WHEEL_NODES] = {
+		70000, 5, 256, 0xffffffffUL, 255, 65536, 300, 0x1000003UL, 65535,
+		0x100000007UL, 0x10000000000UL, 0x1000005UL};
+	tw_node_t nodes[TEST_WHEEL_NODES];
+	tw_node_t removed[2];
+	twheel_t *wheel = TWCreate(0);
+	tw_node_t *node = NULL;
+	unsigned long now = 0;
+	unsigned long last = 0;
+	size_t popped = 0;
+	int is_exact = 1;
+	size_t i = 0;
+
+	if (NULL == wheel)
+	{
+		Check(0, "TWCreate");
+
+		return;
+	}
+
+	for (i = 0; i < TEST_WHEEL_NODES; ++i)
+	{
+		TWInsert(wheel, &nodes[i], expires[i]);
+	}
+
+	/* one node in a high level and one in the overflow leave before they
+		cascade */
+	TWInsert(wheel, &removed[0], 0x1000004UL);
+	TWInsert(wheel, &removed[1], 0x100000008UL);
+	TWRemove(wheel, &removed[0]);
+	TWRemove(wheel, &removed[1]);
+	Check(TEST_WHEEL_NODES == TWSize(wheel), "wheel size after remove");
+
+	while (0 == TWIsEmpty(wheel))
+	{
+		/* the next expiry is never after the first node */
+		now = TWNextExpiry(wheel);
+		is_exact &= (now >= last);
+		last = now;
+
+		while (NULL != (node = TWPopExpired(wheel, now)))
+		{
+			is_exact &= (node->expires == now);
+			++popped;
+		}
+	}
+
+	Check(1 == is_exact, "wheel nodes pop at their tick");
+	Check(TEST_WHEEL_NODES == popped, "wheel pops every node once");
+
+	/* a tick that passed already expires at once */
+	TWInsert(wheel, &nodes[0], 10);
+	Check(&nodes[0] == TWPopExpired(wheel, now), "wheel expires a past tick");
+
+	TWDestroy(wheel);
+}
+
+/****************************************************************************/
+
+/* the wheel backend runs tasks of every level, and one in the overflow,
+	on their time */
+static void TestWheelSched(void)
+{
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	timed_t tasks[4];
+	sched_t *sched = CreateVirtual(SCH_BACKEND_WHEEL, &clock, &time);
+	size_t i = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (wheel)");
+
+		return;
+	}
+
+	/* 1 ms ticks - level 0, 1, 2, and 60 days is after 2^32 ticks */
+	InitTimed(&tasks[0], &time, SCH_MSEC(3), 1000);
+	InitTimed(&tasks[1], &time, SCH_MSEC(700), 100);
+	InitTimed(&tasks[2], &time, SCH_SEC(90), 50);
+	InitTimed(&tasks[3], &time, SCH_SEC(60 * 86400), 2);
+
+	for (i = 0; i < 4; ++i)
+	{
+		SCHAddInterval(sched, &RunTimed, &tasks[i], tasks[i].interval);
+	}
+
+	Check(0 == SCHRun(sched), "wheel SCHRun ends when the tasks end");
+
+	for (i = 0; i < 4; ++i)
+	{
+		Check(tasks[i].runs == tasks[i].max_runs, "wheel task runs");
+		Check(0 == tasks[i].is_late, "wheel task runs on its time");
+	}
+
+	Check(SCH_SEC(120 * 86400) == time, "wheel clock ends at the last run");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* a uid that is removed moves the next ones of its run back, and every
+	uid is still found after it (with no tombstones) */
+static void TestUIDMapRemove(void)
+{
+	static uid_type uids[TEST_MAP_BIG];
+	static char data[TEST_MAP_BIG];
+	static int is_in[TEST_MAP_BIG];
+	uidmap_t *map = UIDMapCreate();
+	uid_type first = UIDCreate();
+	size_t live = 0;
+	size_t i = 0;
+	size_t op = 0;
+	int is_same = 1;
+
+	if (NULL == map)
+	{
+		Check(0, "UIDMapCreate");
+
+		return;
+	}
+
+	/* uids of one process and one time, that differ by their counter */
+	for (i = 0; i < TEST_MAP_BIG; ++i)
+	{
+		uids[i] = first;
+		uids[i].counter += i;
+		is_in[i] = 0;
+	}
+
+	for (op = 0; op < TEST_MAP_OPS; ++op)
+	{
+		i = Random() % TEST_MAP_UIDS;
+
+		if (1 == is_in[i])
+		{
+			is_same &= (&data[i] == UIDMapRemove(map, uids[i]));
+			is_in[i] = 0;
+			--live;
+		}
+		else if (TEST_MAP_LIVE > live)
+		{
+			is_same &= (0 == UIDMapInsert(map, uids[i], &data[i]));
+			is_in[i] = 1;
+			++live;
+		}
+
+		is_same &= IsMapSame(map, uids, data, is_in, TEST_MAP_UIDS);
+		is_same &= (live == UIDMapSize(map));
+	}
+
+	Check(1 == is_same, "uidmap finds every uid after a remove");
+	Check(NULL == UIDMapRemove(map, uids[TEST_MAP_UIDS]),
+		  "uidmap removes a uid that isn't there");
+
+	/* a big map that grows, loses every other uid, and gets them back */
+	UIDMapClear(map);
+
+	for (i = 0; i < TEST_MAP_BIG; ++i)
+	{
+		UIDMapInsert(map, uids[i], &data[i]);
+		is_in[i] = 1;
+	}
+
+	for (i = 1; i < TEST_MAP_BIG; i += 2)
+	{
+		UIDMapRemove(map, uids[i]);
+		is_in[i] = 0;
+	}
+
+	Check(1 == IsMapSame(map, uids, data, is_in, TEST_MAP_BIG),
+		  "uidmap finds every uid after half are removed");
+
+	for (i = 1; i < TEST_MAP_BIG; i += 2)
+	{
+		UIDMapInsert(map, uids[i], &data[i]);
+		is_in[i] = 1;
+	}
+
+	for (i = 0; i < TEST_MAP_BIG; i += 2)
+	{
+		UIDMapRemove(map, uids[i]);
+		is_in[i] = 0;
+	}
+
+	Check(1 == IsMapSame(map, uids, data, is_in, TEST_MAP_BIG),
+		  "uidmap finds every uid after they are added back");
+	Check(TEST_MAP_BIG / 2 == UIDMapSize(map), "uidmap size");
+
+	UIDMapDestroy(map);
+}
+
+/****************************************************************************/
+
+/* a task removes one task of its batch that ran before it, and two that
+	wait to run after it - they never run again */
+static void TestRemoveInBatch(sched_backend_t backend)
+{
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	timed_t victims[3];
+	remover_t remover;
+	sched_t *sched = CreateVirtual(backend, &clock, &time);
+	sched_time_t slack = 0;
+	size_t i = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (remove in batch)");
+
+		return;
+	}
+
+	remover.sched = sched;
+	remover.runs = 0;
+
+	/* all of them are due together, and they run by their deadlines
+		(a slot of the wheel keeps the order that they were added in).
+		alone, the remover runs on its deadline */
+	slack = (SCH_BACKEND_WHEEL == backend) ? 0 : SCH_USEC(1);
+
+	for (i = 0; i < 3; ++i)
+	{
+		InitTimed(&victims[i], &time, SCH_MSEC(10), 1000);
+	}
+
+	remover.victims[0] = SCHAddInterval(sched, &RunTimed, &victims[0], SCH_MSEC(10));
+	remover.self = SCHAddWithSlack(sched, &RunRemover, &remover, SCH_MSEC(10),
+								   slack);
+	remover.victims[1] = SCHAddWithSlack(sched, &RunTimed, &victims[1],
+										 SCH_MSEC(10), 2 * slack);
+	remover.victims[2] = SCHAddWithSlack(sched, &RunTimed, &victims[2],
+										 SCH_MSEC(10), 2 * slack);
+
+	Check(0 == SCHRun(sched), "remove in batch - SCHRun ends without tasks");
+	Check(5 == remover.runs, "remove in batch - the remover runs");
+	Check(3 == victims[0].runs, "remove in batch - a task that ran before");
+	Check(2 == victims[1].runs, "remove in batch - a task that waited");
+	Check(2 == victims[2].runs, "remove in batch - the last task");
+	Check(0 == SCHSize(sched), "remove in batch - the scheduler is empty");
+	Check(SCH_MSEC(50) + slack == time, "remove in batch - the last run");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* a task of 10 ms moves in its first run (at 10) itself to every 30 ms, a
+	task of its batch to 25, a task of 100 ms from 100 to 15, and a task of
+	20 ms to every 50 ms - they run by their new times */
+static void TestReschedule(sched_backend_t backend)
+{
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	mover_t mover;
+	stalled_t in_batch;
+	stalled_t earlier;
+	stalled_t later;
+	sched_t *sched = CreateVirtual(backend, &clock, &time);
+	sched_time_t slack = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (reschedule)");
+
+		return;
+	}
+
+	/* the task of the batch runs after the mover (see TestRemoveInBatch) */
+	slack = (SCH_BACKEND_WHEEL == backend) ? 0 : SCH_USEC(1);
+
+	InitLog(&mover.log, &time);
+	InitLog(&in_batch, &time);
+	InitLog(&earlier, &time);
+	InitLog(&later, &time);
+
+	mover.sched = sched;
+	mover.self = SCHAddInterval(sched, &RunMover, &mover, SCH_MSEC(10));
+	mover.in_batch = SCHAddWithSlack(sched, &RunStalled, &in_batch, SCH_MSEC(10),
+									 slack);
+	mover.earlier = SCHAddInterval(sched, &RunStalled, &earlier, SCH_MSEC(100));
+	mover.later = SCHAddInterval(sched, &RunStalled, &later, SCH_MSEC(20));
+
+	Check(0 == SCHRun(sched), "reschedule - SCHRun ends without tasks");
+	Check(1 == IsEvery(&mover.log, SCH_MSEC(10), SCH_MSEC(30)),
+		  "reschedule - the running task runs by its new interval");
+	Check(1 == IsEvery(&in_batch, SCH_MSEC(25) + slack, SCH_MSEC(10)),
+		  "reschedule - the task of the batch runs at its new time");
+	Check(1 == IsEvery(&earlier, SCH_MSEC(15), SCH_MSEC(100)),
+		  "reschedule - the sooner task keeps its interval");
+	Check(1 == IsEvery(&later, SCH_MSEC(60), SCH_MSEC(50)),
+		  "reschedule - the later task runs by its new interval");
+	Check(1 == SCHReschedule(sched, mover.self, SCH_MSEC(1)),
+		  "reschedule - a task that ended");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* a task in 10..14 ms and a task in 11..13 ms share one wake up, and a
+	task at 20 ms has its own - every task runs in its window */
+static void TestSlack(sched_backend_t backend)
+{
+	counted_t counted = {0, 0};
+	sched_clock_t clock;
+	sched_attr_t attr;
+	windowed_t first;
+	windowed_t second;
+	windowed_t alone;
+	sched_t *sched = NULL;
+
+	clock.now = &CountedNow;
+	clock.advance = &CountedAdvance;
+	clock.arg = &counted;
+
+	SCHAttrInit(&attr);
+	attr.backend = backend;
+	attr.clock = &clock;
+
+	sched = SCHCreateWithAttr(&attr);
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (slack)");
+
+		return;
+	}
+
+	first.clock = &counted;
+	second.clock = &counted;
+	alone.clock = &counted;
+
+	SCHAddWithSlack(sched, &RunWindowed, &first, SCH_MSEC(10), SCH_MSEC(4));
+	SCHAddWithSlack(sched, &RunWindowed, &second, SCH_MSEC(11), SCH_MSEC(2));
+	SCHAddInterval(sched, &RunWindowed, &alone, SCH_MSEC(20));
+
+	Check(0 == SCHRun(sched), "slack - SCHRun ends without tasks");
+	Check(2 == counted.advances, "slack - the overlapping windows share a wake up");
+	Check(first.ran_at == second.ran_at, "slack - the tasks run together");
+	Check((SCH_MSEC(10) <= first.ran_at) && (SCH_MSEC(14) >= first.ran_at),
+		  "slack - the first task runs in its window");
+	Check((SCH_MSEC(11) <= second.ran_at) && (SCH_MSEC(13) >= second.ran_at),
+		  "slack - the second task runs in its window");
+	Check(SCH_MSEC(20) == alone.ran_at, "slack - a task without slack runs on time");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* a task that backs off by SCH_NEXT_AFTER, then moves to an absolute time
+	by SCH_NEXT_AT, and ends - and a run that takes long, that its
+	SCH_NEXT_AFTER counts from the time it was due (the skip policy goes
+	to the slots of 10 ms from 10 ms, not from the end of the run) */
+static void TestDynamic(sched_backend_t backend)
+{
+	static const sched_time_t expected[] = {SCH_MSEC(1), SCH_MSEC(3), SCH_MSEC(7),
+											SCH_MSEC(15), SCH_MSEC(20), SCH_MSEC(28)};
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	dynamic_t dynamic;
+	stalled_t stalled;
+	sched_stats_t stats;
+	sched_t *sched = CreateVirtual(backend, &clock, &time);
+	int is_on_time = 1;
+	size_t i = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (dynamic)");
+
+		return;
+	}
+
+	dynamic.time = &time;
+	dynamic.runs = 0;
+
+	SCHAddDynamic(sched, &RunDynamic, &dynamic, SCH_MSEC(1), 0);
+	SCHRun(sched);
+
+	for (i = 0; i < TEST_DYNAMIC_RUNS; ++i)
+	{
+		is_on_time &= (expected[i] == dynamic.runs_at[i]);
+	}
+
+	Check(TEST_DYNAMIC_RUNS == dynamic.runs, "dynamic - the task ends by 0");
+	Check(1 == is_on_time, "dynamic - every run at the time that the task chose");
+
+	SCHDestroy(sched);
+
+	sched = CreateVirtual(backend, &clock, &time);
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (dynamic)");
+
+		return;
+	}
+
+	stalled.time = &time;
+	stalled.runs = 0;
+	stalled.stall_run = 1;
+	stalled.stall_to = SCH_MSEC(35);
+
+	SCHSetCatchUp(sched, SCHAddDynamic(sched, &RunLateDynamic, &stalled,
+									   SCH_MSEC(10), 0),
+				  SCH_CATCH_UP_SKIP);
+	SCHRun(sched);
+	SCHGetStats(sched, &stats);
+
+	Check((2 == stalled.runs) && (SCH_MSEC(10) == stalled.runs_at[0]) &&
+		  (SCH_MSEC(40) == stalled.runs_at[1]),
+		  "dynamic - SCH_NEXT_AFTER counts from the time the run was due");
+	Check(2 == stats.missed, "dynamic - the slots of 20 and 30 ms are missed");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* a heavy task of 10 ms, a light one of 5 ms and a medium one of 12 ms -
+	at 37 ms the heavy one is first, then the medium one, and the list
+	of two has only them */
+static void TestTopTasks(void)
+{
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	reporter_t reporter;
+	costly_t heavy;
+	costly_t light;
+	costly_t medium;
+	uid_type heavy_uid;
+	uid_type light_uid;
+	uid_type medium_uid;
+	sched_t *sched = CreateVirtual(SCH_BACKEND_HEAP, &clock, &time);
+	size_t i = 0;
+	int is_light = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (top tasks)");
+
+		return;
+	}
+
+	reporter.sched = sched;
+	reporter.count = 0;
+	reporter.all_count = 0;
+	reporter.is_done = 0;
+
+	heavy.busy = SCH_MSEC(8);
+	light.busy = 0;
+	medium.busy = SCH_MSEC(2);
+	heavy.is_done = &reporter.is_done;
+	light.is_done = &reporter.is_done;
+	medium.is_done = &reporter.is_done;
+
+	heavy_uid = SCHAddInterval(sched, &RunCostly, &heavy, SCH_MSEC(10));
+	light_uid = SCHAddInterval(sched, &RunCostly, &light, SCH_MSEC(5));
+	medium_uid = SCHAddInterval(sched, &RunCostly, &medium, SCH_MSEC(12));
+	SCHAddInterval(sched, &RunReporter, &reporter, SCH_MSEC(37));
+
+	Check(0 == SCHRun(sched), "top tasks - SCHRun ends without tasks");
+	Check(2 == reporter.count, "top tasks - the list is cut at max");
+	Check((1 == UIDIsSame(heavy_uid, reporter.costs[0].uid)) &&
+		  (&heavy == reporter.costs[0].arg) && (3 == reporter.costs[0].runs),
+		  "top tasks - the heavy task is first, with its runs");
+	Check((1 == UIDIsSame(medium_uid, reporter.costs[1].uid)) &&
+		  (3 == reporter.costs[1].runs) &&
+		  (reporter.costs[1].cpu_time < reporter.costs[0].cpu_time),
+		  "top tasks - the medium task is second, with its runs");
+	Check(TEST_TOP_TASKS == reporter.all_count, "top tasks - all the tasks");
+
+	for (i = 0; i < reporter.all_count; ++i)
+	{
+		is_light |= ((1 == UIDIsSame(light_uid, reporter.all[i].uid)) &&
+					 (7 == reporter.all[i].runs));
+	}
+
+	Check(1 == is_light, "top tasks - the light task, with its runs");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* every item that is given to the workers runs once, and comes back with
+	its result - while the workers steal from each other and sleep */
+static void TestWorkers(void)
+{
+	static int items[TEST_WORK_ITEMS];
+	size_t done = 0;
+	size_t taken = 0;
+	size_t i = 0;
+	int result = 0;
+	int is_once = 1;
+	wpool_t *pool = WPCreate(TEST_WORKERS, &RunItem, &CountDone, &done);
+
+	if (NULL == pool)
+	{
+		Check(0, "WPCreate");
+
+		return;
+	}
+
+	for (i = 0; i < TEST_WORK_ITEMS; ++i)
+	{
+		items[i] = 0;
+		Check(0 == WPSubmit(pool, &items[i]), "WPSubmit");
+
+		/* the workers go to sleep and wake up again now and then */
+		if (0 == (i % 1000))
+		{
+			while (__sync_fetch_and_add(&done, 0) < i)
+			{
+				;
+			}
+		}
+	}
+
+	while (taken < TEST_WORK_ITEMS)
+	{
+		if (NULL != WPTakeDone(pool, &result))
+		{
+			is_once &= (1 == result);
+			++taken;
+		}
+	}
+
+	WPDestroy(pool);
+
+	for (i = 0; i < TEST_WORK_ITEMS; ++i)
+	{
+		is_once &= (1 == items[i]);
+	}
+
+	Check(1 == is_once, "every item runs once on the workers");
+	Check(TEST_WORK_ITEMS == done, "the workers notify every item");
+}
+
+/****************************************************************************/
+
+/* the deques take turns, so an item goes behind a busy worker - the other
+	worker (done with its own item, and sleeping) steals it */
+static void TestSteal(void)
+{
+	int items[3] = {TEST_BLOCKED, 0, 0};
+	size_t done = 0;
+	sched_time_t start = 0;
+	int result = 0;
+	int is_stolen = 0;
+	wpool_t *pool = WPCreate(2, &RunBlocking, &CountDone, &done);
+
+	if (NULL == pool)
+	{
+		Check(0, "WPCreate");
+
+		return;
+	}
+
+	g_is_released = 0;
+
+	WPSubmit(pool, &items[0]);
+	WPSubmit(pool, &items[1]);
+
+	while (0 == __sync_fetch_and_add(&done, 0))
+	{
+		;
+	}
+
+	WPSubmit(pool, &items[2]);
+
+	start = SCHTimeNow();
+	while ((0 == is_stolen) && (SCH_MSEC(TEST_STEAL_WAIT_MS) > SCHTimeNow() - start))
+	{
+		is_stolen = (&items[2] == WPTakeDone(pool, &result));
+	}
+
+	Check(1 == is_stolen, "an item behind a busy worker is stolen");
+
+	__sync_fetch_and_add(&g_is_released, 1);
+
+	WPDestroy(pool);
+}
+
+/****************************************************************************/
+
+/* many threads push at once, and one thread takes - every node comes out
+	once, and the nodes of every thread by the order of their pushes */
+static void TestMPSC(void)
+{
+	static pushed_t nodes[TEST_PRODUCERS][TEST_PUSHES];
+	producer_t producers[TEST_PRODUCERS];
+	size_t next_seq[TEST_PRODUCERS] = {0};
+	mpscq_t *queue = MPSCCreate();
+	mpsc_node_t *node = NULL;
+	pushed_t *pushed = NULL;
+	size_t taken = 0;
+	size_t i = 0;
+	int is_ordered = 1;
+
+	if (NULL == queue)
+	{
+		Check(0, "MPSCCreate");
+
+		return;
+	}
+
+	Check(1 == MPSCPush(queue, &nodes[0][0].node), "MPSCPush to an empty queue");
+	Check(0 == MPSCPush(queue, &nodes[0][1].node), "MPSCPush to a queue");
+	Check((&nodes[0][0].node == MPSCTakeAll(queue)) &&
+		  (&nodes[0][1].node == nodes[0][0].node.next) &&
+		  (NULL == nodes[0][1].node.next), "MPSCTakeAll by the order of the pushes");
+	Check(NULL == MPSCTakeAll(queue), "MPSCTakeAll of an empty queue");
+
+	for (i = 0; i < TEST_PRODUCERS; ++i)
+	{
+		producers[i].queue = queue;
+		producers[i].nodes = nodes[i];
+		producers[i].index = i;
+		pthread_create(&producers[i].thread, NULL, &PushAll, &producers[i]);
+	}
+
+	while (taken < TEST_PRODUCERS * TEST_PUSHES)
+	{
+		for (node = MPSCTakeAll(queue); NULL != node; node = node->next)
+		{
+			pushed = (pushed_t *)node;
+			is_ordered &= (pushed->seq == next_seq[pushed->producer]);
+			++next_seq[pushed->producer];
+			++taken;
+		}
+	}
+
+	for (i = 0; i < TEST_PRODUCERS; ++i)
+	{
+		pthread_join(producers[i].thread, NULL);
+	}
+
+	Check(1 == is_ordered, "MPSC keeps the order of every producer");
+	Check(NULL == MPSCTakeAll(queue), "MPSC takes every node once");
+
+	MPSCDestroy(queue);
+}
+
+/****************************************************************************/
+
+/* other threads add and remove tasks while SCHRun runs (on the monotonic
+	clock - the virtual clock belongs to the thread of SCHRun) */
+static void TestOtherThreads(void)
+{
+	producer_t producers[TEST_PRODUCERS];
+	size_t expected = TEST_PRODUCERS * TEST_ADDS / 2;
+	sched_t *sched = SCHCreate();
+	size_t i = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreate");
+
+		return;
+	}
+
+	SCHAddInterval(sched, &RunKeeper, &expected, SCH_MSEC(1));
+
+	for (i = 0; i < TEST_PRODUCERS; ++i)
+	{
+		producers[i].sched = sched;
+		pthread_create(&producers[i].thread, NULL, &AddAll, &producers[i]);
+	}
+
+	Check(0 == SCHRun(sched), "other threads - SCHRun ends without tasks");
+
+	for (i = 0; i < TEST_PRODUCERS; ++i)
+	{
+		pthread_join(producers[i].thread, NULL);
+	}
+
+	Check(expected == g_added_runs, "other threads - the tasks that weren't removed run");
+	Check(0 == SCHSize(sched), "other threads - the removed tasks left");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* another thread watches fds, and stops watching one of them - SCHRun
+	takes its requests by their order (they are all sent before it starts,
+	so it can't wait between them) */
+static void TestOtherThreadFds(void)
+{
+	watched_t watched;
+	sched_t *sched = SCHCreate();
+	size_t i = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreate");
+
+		return;
+	}
+
+	if ((0 != pipe(watched.pipes[0])) || (0 != pipe(watched.pipes[1])))
+	{
+		Check(0, "pipe");
+		SCHDestroy(sched);
+
+		return;
+	}
+
+	watched.sched = sched;
+	watched.reads[0] = 0;
+	watched.reads[1] = 0;
+
+	SCHAddInterval(sched, &RunUntilRead, &watched, SCH_MSEC(1));
+	pthread_create(&watched.thread, NULL, &WatchPipes, &watched);
+	pthread_join(watched.thread, NULL);
+
+	Check(0 == SCHRun(sched), "other thread fds - SCHRun ends without tasks and fds");
+
+	Check(1 == watched.reads[1], "other thread fds - a fd that was added");
+	Check(0 == watched.reads[0], "other thread fds - a fd that was removed");
+
+	for (i = 0; i < 4; ++i)
+	{
+		close(watched.pipes[i / 2][i % 2]);
+	}
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* 'count' tasks are added in a batch after 'before' tasks were added one
+	by one, with their times mixed - every task runs on its time.
+	on the heap, a big batch builds the heap again, and a small one is
+	pushed (see HeapPushBatch), and on the list it's merged */
+static void TestAddBatch(sched_backend_t backend, size_t before, size_t count)
+{
+	static timed_t timed[TEST_BATCH_TASKS];
+	sched_task_spec_t specs[TEST_BATCH_TASKS];
+	uid_type uids[TEST_BATCH_TASKS];
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	sched_t *sched = CreateVirtual(backend, &clock, &time);
+	size_t missed = 0;
+	size_t i = 0;
+	int is_in = 1;
+	int is_on_time = 1;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (add batch)");
+
+		return;
+	}
+
+	for (i = 0; i < before + count; ++i)
+	{
+		InitTimed(&timed[i], &time,
+				  SCH_MSEC((i * TEST_BATCH_STEP) % (before + count) + 1), 1);
+	}
+
+	/* the batch has the first time (of 1 ms) */
+	for (i = 0; i < before; ++i)
+	{
+		SCHAddInterval(sched, &RunTimed, &timed[count + i],
+					   timed[count + i].interval);
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		specs[i].func = &RunTimed;
+		specs[i].arg = &timed[i];
+		specs[i].interval = timed[i].interval;
+		specs[i].slack = 0;
+	}
+
+	Check(0 == SCHAddBatch(sched, specs, count, uids), "add batch - SCHAddBatch");
+	Check(before + count == SCHSize(sched), "add batch - the size");
+
+	for (i = 0; i < count; ++i)
+	{
+		is_in &= (0 == SCHGetMissed(sched, uids[i], &missed));
+	}
+
+	Check(1 == is_in, "add batch - the uids of the tasks");
+	Check(0 == SCHRun(sched), "add batch - SCHRun ends without tasks");
+
+	for (i = 0; i < before + count; ++i)
+	{
+		is_on_time &= ((1 == timed[i].runs) && (0 == timed[i].is_late));
+	}
+
+	Check(1 == is_on_time, "add batch - every task runs on its time");
+	Check(SCH_MSEC(before + count) == time, "add batch - the last run");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* another thread adds a batch while SCHRun runs - its tasks run by their
+	times */
+static void TestOtherThreadBatch(void)
+{
+	producer_t producer;
+	size_t expected = TEST_BATCH_THREAD;
+	sched_t *sched = SCHCreate();
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreate");
+
+		return;
+	}
+
+	g_added_runs = 0;
+
+	SCHAddInterval(sched, &RunKeeper, &expected, SCH_MSEC(1));
+
+	producer.sched = sched;
+	pthread_create(&producer.thread, NULL, &AddBatchAll, &producer);
+
+	Check(0 == SCHRun(sched), "batch from another thread - SCHRun ends without tasks");
+
+	pthread_join(producer.thread, NULL);
+
+	Check(TEST_BATCH_THREAD == g_added_runs, "batch from another thread - every task runs");
+	Check(1 == g_is_in_order, "batch from another thread - the tasks run by their times");
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+
+/* the tasks of a key run on the scheduler of the key - on its own thread,
+	and not on the thread of another scheduler of the group */
+static void TestGroup(void)
+{
+	sharded_t tasks[TEST_SHARD_TASKS];
+	size_t shards[TEST_SHARD_TASKS];
+	pthread_t threads[TEST_SHARDS];
+	int is_used[TEST_SHARDS] = {0};
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	sched_attr_t attr;
+	sched_group_t *group = NULL;
+	size_t done = 0;
+	size_t i = 0;
+	int is_own = 1;
+
+	SCHAttrInit(&attr);
+	SCHClockInitVirtual(&clock, &time);
+	attr.clock = &clock;
+
+	Check(NULL == SCHGroupCreate(TEST_SHARDS, &attr),
+		  "group - a virtual clock isn't shared");
+
+	group = SCHGroupCreate(TEST_SHARDS, NULL);
+	if (NULL == group)
+	{
+		Check(0, "SCHGroupCreate");
+
+		return;
+	}
+
+	for (i = 0; i < TEST_SHARD_TASKS; ++i)
+	{
+		tasks[i].done = &done;
+		shards[i] = SCHGroupIndexOf(group, i);
+		is_used[shards[i]] = 1;
+		SCHGroupAdd(group, i, &RunSharded, &tasks[i], SCH_MSEC(1));
+	}
+
+	while (TEST_SHARD_TASKS > __sync_fetch_and_add(&done, 0))
+	{
+		;
+	}
+
+	SCHGroupDestroy(group);
+
+	for (i = 0; i < TEST_SHARD_TASKS; ++i)
+	{
+		threads[shards[i]] = tasks[i].thread;
+	}
+
+	Check((1 == is_used[0]) && (1 == is_used[1]), "group - the keys go to every shard");
+
+	for (i = 0; (1 == is_used[0]) && (1 == is_used[1]) && (i < TEST_SHARD_TASKS); ++i)
+	{
+		is_own &= ((0 != pthread_equal(threads[shards[i]], tasks[i].thread)) &&
+				   (0 == pthread_equal(threads[1 - shards[i]], tasks[i].thread)) &&
+				   (0 == pthread_equal(pthread_self(), tasks[i].thread)));
+	}
+
+	Check(1 == is_own, "group - every task runs on its shard");
+}
+
+/****************************************************************************/
+
+/* a task of 1 second with a catch up policy, that stalls from 1.5 to 8 -
+	before its run of 2 (the process stopped), or in it (a long func).
+	'expected' are the times of its runs, and 'missed' - the runs that
+	its policy dropped */
+static void TestCatchUp(sch_catch_up_t catch_up, int is_long_func,
+						const sched_time_t *expected, size_t missed,
+						const char *what)
+{
+	sched_clock_t clock;
+	sched_time_t time = 0;
+	stalled_t stalled;
+	sched_stats_t stats;
+	sched_t *sched = CreateVirtual(SCH_BACKEND_HEAP, &clock, &time);
+	int is_on_time = 1;
+	size_t i = 0;
+
+	if (NULL == sched)
+	{
+		Check(0, "SCHCreateWithAttr (catch up)");
+
+		return;
+	}
+
+	stalled.time = &time;
+	stalled.runs = 0;
+	stalled.stall_run = (1 == is_long_func) ? 2 : 0;
+	stalled.stall_to = SCH_SEC(8);
+
+	SCHSetCatchUp(sched, SCHAddInterval(sched, &RunStalled, &stalled, SCH_SEC(1)),
+				  catch_up);
+
+	if (0 == is_long_func)
+	{
+		SCHAddInterval(sched, &RunStall, &stalled, SCH_MSEC(1500));
+	}
+
+	SCHRun(sched);
+	SCHGetStats(sched, &stats);
+
+	for (i = 0; i < TEST_STALL_RUNS; ++i)
+	{
+		is_on_time &= (expected[i] == stalled.runs_at[i]);
+	}
+
+	Check(1 == is_on_time, what);
+	Check(missed == stats.missed, what);
+
+	SCHDestroy(sched);
+}
+
+/****************************************************************************/
+/* 			                	Main                                          */
+/****************************************************************************/
+
+int main(void)
+{
+	/* the stall moves the clock from 1.5 to 8 */
+	static const sched_time_t coalesce_stop[] = {SCH_SEC(1), SCH_SEC(8), SCH_SEC(9),
+												 SCH_SEC(10)};
+	static const sched_time_t coalesce_long[] = {SCH_SEC(1), SCH_SEC(2), SCH_SEC(8),
+												 SCH_SEC(9)};
+	static const sched_time_t skip_long[] = {SCH_SEC(1), SCH_SEC(2), SCH_SEC(9),
+											 SCH_SEC(10)};
+
+	TestWheelCascade();
+	TestWheelSched();
+	TestUIDMapRemove();
+	TestRemoveInBatch(SCH_BACKEND_HEAP);
+	TestRemoveInBatch(SCH_BACKEND_SORTED_LIST);
+	TestRemoveInBatch(SCH_BACKEND_WHEEL);
+	TestReschedule(SCH_BACKEND_HEAP);
+	TestReschedule(SCH_BACKEND_SORTED_LIST);
+	TestReschedule(SCH_BACKEND_WHEEL);
+	TestAddBatch(SCH_BACKEND_HEAP, 4, 12);
+	TestAddBatch(SCH_BACKEND_HEAP, TEST_BATCH_TASKS - 4, 4);
+	TestAddBatch(SCH_BACKEND_SORTED_LIST, 4, 12);
+	TestAddBatch(SCH_BACKEND_SORTED_LIST, TEST_BATCH_TASKS - 4, 4);
+	TestAddBatch(SCH_BACKEND_WHEEL, 4, 12);
+	TestAddBatch(SCH_BACKEND_WHEEL, TEST_BATCH_TASKS - 4, 4);
+	TestSlack(SCH_BACKEND_HEAP);
+	TestSlack(SCH_BACKEND_SORTED_LIST);
+	TestSlack(SCH_BACKEND_WHEEL);
+	TestDynamic(SCH_BACKEND_HEAP);
+	TestDynamic(SCH_BACKEND_SORTED_LIST);
+	TestDynamic(SCH_BACKEND_WHEEL);
+	TestTopTasks();
+	TestWorkers();
+	TestSteal();
+	TestMPSC();
+	TestOtherThreads();
+	TestOtherThreadFds();
+	TestOtherThreadBatch();
+	TestGroup();
+	TestCatchUp(SCH_CATCH_UP_COALESCE, 0, coalesce_stop, 6,
+				"coalesce - one run after a stopped process");
+	TestCatchUp(SCH_CATCH_UP_COALESCE, 1, coalesce_long, 5,
+				"coalesce - one more run after a long func");
+	TestCatchUp(SCH_CATCH_UP_SKIP, 0, coalesce_stop, 6,
+				"skip - the late run only after a stopped process");
+	TestCatchUp(SCH_CATCH_UP_SKIP, 1, skip_long, 6,
+				"skip - the next slot after a long func");
+
+	if (0 == g_failed)
+	{
+		printf("all the tests passed\n");
+	}
+
+	return ((int)g_failed);
+}
@@ -1,4 +1,4 @@
-#define _GNU_SOURCE			/* kill */
+#define _GNU_SOURCE		/* kill, syscall, robust mutex */
 
 #include <assert.h>			/* assert */
 #include <unistd.h>			/* access */
@@ -8,8 +8,15 @@
 #include <sys/stat.h>       /* For mode constants - named semaphore */
 #include <errno.h>			/* errno */
 #include <string.h>    		/* memset */
+#include <stdio.h>		/* sprintf */
 #include <pthread.h>		/* pthread */
 #include <stdlib.h>			/* setenv, getenv */
+#include <stdint.h>			/* uint32_t, uint64_t */
+#include <sys/mman.h>		/* shm_open, mmap - the heartbeats */
+#include <sys/syscall.h>	/* SYS_pidfd_open, SYS_pidfd_send_signal */
+#include <sys/wait.h>		/* waitpid */
+#include <spawn.h>			/* posix_spawnp */
+#include <sys/prctl.h>		/* prctl - the standby dies with its watchdog */
 
 #include "watchdog.h"		/* watchdog */
 #include "sched/uid.h"		/* uid */
@@ -17,10 +24,26 @@
 
 /******************************************************************************/
 
-#define CHECK_INTERVAL 3
-#define SEND_INTERVAL 1
-#define TRY_TO_CLOSE_PROCESS 5
+#define CHECK_INTERVAL_MS 3000
+#define CHECK_BACKOFF_MAX_MS 60000
+#define SEND_INTERVAL_MS 1000
+#define TASK_SLACK_MS 100
 #define WATCHDOG_FILE_PATH "./wd.out"
+#define HEARTBEAT_MAGIC 0x57444842UL	/* "WDHB" */
+#define CACHE_LINE 64
+#define HOT_STANDBY_ENV "WD_HOT_STANDBY"	/* "1" - keep a standby of the app */
+#define STANDBY_ENV "WD_STANDBY"			/* set in the standby itself */
+#define SLOT_ENV "WD_SLOT"		/* the slot of an app that the watchdog started */
+#define WATCHDOG_PID_ENV "WD_WATCHDOG_PID"	/* the watchdog of a standby */
+#define WD_MAX_APPS 64		/* the apps that one watchdog watches */
+#define WD_ARGS_MAX 64		/* the args of an app (with its path) */
+#define WD_ARGS_SIZE 1012		/* all of them, one after the other */
+#define NAME_SIZE 64
+#define STAT_SIZE 512		/* /proc/<pid>/stat, up to its start time */
+#define STAT_START_FIELD 22		/* the start time in /proc/<pid>/stat */
+#define OPEN_TRIES 1000		/* a segment that another process creates now */
+#define OPEN_WAIT_US 1000
+#define JOIN_TRIES 3		/* a segment that its watchdog removed now */
 
 /******************************************************************************/
 
@@ -28,12 +51,89 @@ typedef int boolean;
 
 enum { STOP = 0, RERUN = 1 };
 
+/* the slots of the heartbeat segment - the watchdog, and then the apps */
+enum { SLOT_WD = 0, SLOT_COUNT = WD_MAX_APPS + 1 };
+
+enum { ENTRY_FREE = 0, ENTRY_READY = 1 };
+
+/* the heartbeats of one process - only it writes them, so a heartbeat is
+	one atomic add and one store, without a syscall or a signal.
+	every slot has its own cache lines */
+typedef union
+{
+	struct
+	{
+		volatile uint64_t beats;		/* the heartbeats so far */
+		volatile int64_t last_beat;		/* the monotonic time of the last one */
+		volatile pid_t pid;
+		volatile uint64_t start;		/* of 'pid' - see StartTimeOf */
+		volatile uint64_t spawns;		/* the partners that it spawned */
+		volatile int64_t spawn_exec;	/* the last spawn until the exec */
+		volatile int64_t spawn_exec_max;
+		volatile int64_t spawn_ready;	/* the last spawn until it was up */
+		volatile int64_t up_since;		/* the time of its first heartbeat */
+		volatile pid_t spawner;		/* an app that spawns the watchdog now
+										(0 - none) - see Resurrect */
+		volatile uint64_t spawner_start;		/* of 'spawner' */
+	} beat;
+	char line[2 * CACHE_LINE];
+} wd_slot_t;
+
+/* an app in the table of the watchdog - what it needs to start it again */
+typedef struct
+{
+	volatile uint32_t state;		/* set last - the entry is ready */
+	uint32_t generation;		/* a new app in the slot - a new generation */
+	uint32_t hot_standby;		/* the app asked for a standby */
+	uint32_t argc;
+	char args[WD_ARGS_SIZE];		/* the args, with their '\0' */
+} wd_entry_t;
+
+/* the head of the shared segment, and after it 'slots' slots
+	(a slot for every process that is watched, and one for the watchdog),
+	and then an entry for every slot */
+typedef union
+{
+	struct
+	{
+		volatile uint32_t magic;		/* set last - the segment is ready */
+		uint32_t slots;
+		pthread_mutex_t lock;		/* of the table, and of starting the watchdog */
+	} head;
+	char line[CACHE_LINE];
+} wd_shared_t;
+
+/* a process that this process watches - the watchdog in an app, and every
+	app in the watchdog */
+typedef struct
+{
+	wd_t *wd;
+	size_t slot;
+	pid_t pid;		/* 0 - none */
+	uint64_t start;		/* of 'pid' - see StartTimeOf */
+	int pid_fd;		/* a pidfd of it (-1 - none) */
+	uint64_t beats;		/* its heartbeats in the last check */
+	size_t respawns;		/* the times it was created in a row */
+	sched_time_t spawn_start;		/* the last spawn, until it's up (0 - none) */
+	sched_time_t spawn_exec;
+	sched_time_t taken;		/* when a new partner was taken (0 - none) */
+	pid_t standby;			/* a standby of the app that waits (0 - none) */
+	sem_t *standby_sem;		/* only for an app with a standby */
+	uid_type check;
+	uint32_t generation;		/* of the entry of the app */
+	int is_watched;
+} wd_partner_t;
+
 struct wd 
 {
 	sched_t *sched;
-	pid_t partner;
-	int is_parent_process;
 	char **argv;
+	size_t slot;		/* the slot of this process */
+	wd_slot_t *self;		/* the heartbeats of this process */
+	int shared_fd;
+	pthread_t thread;		/* of the scheduler, in an app - see StopWD */
+	int is_thread;
+	wd_partner_t partners[SLOT_COUNT];		/* by their slots */
 };
 
 typedef enum
@@ -44,234 +144,1383 @@ typedef enum
 
 /******************************************************************************/
 
-static volatile sig_atomic_t g_sig_counter = 0;
 static volatile sig_atomic_t g_to_finish = 0;
-static const char *shared_sem_name = "wd_sem_lock";
-static sem_t *sem_lock = NULL;
+static const char *shared_beat_name = "/wd_heartbeat";
+static const char *standby_sem_name = "wd_sem_standby";
+static wd_shared_t *g_shared = NULL;
+
+extern char **environ;
 static wd_t wd = { 0 };
 
-/******************************************************************************/
-/* 			                SIG Handler Functions                             */  
+/******************************************************************************/
+/* 			                SIG Handler Functions                             */  
+/******************************************************************************/
+
+static void SigHandlerINT(int sig)
+{
+	(void)sig;
+}
+
+/******************************************************************************/
+
+static void SetSignalHandler(void)
+{
+	struct sigaction handle;
+	memset(&handle, 0, sizeof(handle));
+	
+	handle.sa_handler = &SigHandlerINT;
+	sigaction(SIGINT, &handle, NULL);
+}
+
+/******************************************************************************/
+/* 			                Help Functions                                    */  
+/******************************************************************************/
+
+static boolean IsFileExist(const char *file_path)
+{
+	return (0 == access(file_path, F_OK));
+}
+
+/******************************************************************************/
+
+static e_start_from_t StartFrom(void)
+{
+	const char *is_wd = getenv("IS_WD");
+	
+	return (((NULL != is_wd) && (0 == strcmp(is_wd, "1"))) ? FROM_WD : FROM_APP);
+}
+
+/******************************************************************************/
+
+static boolean IsHotStandby(void)
+{
+	const char *mode = getenv(HOT_STANDBY_ENV);
+	
+	return ((NULL != mode) && (0 == strcmp(mode, "1")));
+}
+
+/******************************************************************************/
+
+/* the slot of an app that the watchdog started (0 - none) */
+static size_t SlotFromEnv(void)
+{
+	const char *slot = getenv(SLOT_ENV);
+	
+	return ((NULL != slot) ? (size_t)strtoul(slot, NULL, 10) : 0);
+}
+
+/******************************************************************************/
+
+/* every app with a standby has its own semaphore */
+static void StandbySemName(char *name, size_t slot)
+{
+	sprintf(name, "%s_%lu", standby_sem_name, (unsigned long)slot);
+}
+
+/******************************************************************************/
+
+/* a standby waits here until its watchdog releases it, and then goes on as
+	the app. it can't go on by itself - then there would be two apps */
+static void ParkAsStandby(void)
+{
+	const char *watchdog = getenv(WATCHDOG_PID_ENV);
+	char name[NAME_SIZE];
+	sem_t *sem = NULL;
+	
+	/* a standby of a watchdog that died dies with it - the watchdog that
+		spawned it can be dead already (before the prctl), and then its
+		parent is another process */
+	if ((NULL == watchdog) || (0 != prctl(PR_SET_PDEATHSIG, SIGKILL)) ||
+		(getppid() != (pid_t)strtol(watchdog, NULL, 10)))
+	{
+		_exit(EXIT_FAILURE);
+	}
+	
+	StandbySemName(name, SlotFromEnv());
+	sem = sem_open(name, 0);
+	if (SEM_FAILED == sem)
+	{
+		_exit(EXIT_FAILURE);
+	}
+	
+	while ((0 != sem_wait(sem)) && (EINTR == errno))
+	{
+		;
+	}
+	
+	sem_close(sem);
+	
+	/* now it's the app - it has to live when its watchdog dies */
+	prctl(PR_SET_PDEATHSIG, 0);
+	unsetenv(STANDBY_ENV);
+	unsetenv(WATCHDOG_PID_ENV);
+}
+
+/******************************************************************************/
+
+static wd_slot_t *SlotOf(size_t index)
+{
+	return ((wd_slot_t *)(g_shared + 1) + index);
+}
+
+/******************************************************************************/
+
+static wd_entry_t *EntryOf(size_t index)
+{
+	return ((wd_entry_t *)SlotOf(SLOT_COUNT) + index);
+}
+
+/******************************************************************************/
+
+static size_t SharedSize(void)
+{
+	return (sizeof(wd_shared_t) +
+			SLOT_COUNT * (sizeof(wd_slot_t) + sizeof(wd_entry_t)));
+}
+
+/******************************************************************************/
+
+/* a pid is reused after its process died, but not with the same start time
+	(in clock ticks since the boot) - the pid and its start time are the
+	process itself.
+	returns 0 if there is no such process */
+static uint64_t StartTimeOf(pid_t pid)
+{
+	char path[NAME_SIZE];
+	char stat[STAT_SIZE];
+	const char *field = NULL;
+	ssize_t len = 0;
+	size_t i = 0;
+	int fd = -1;
+	
+	sprintf(path, "/proc/%ld/stat", (long)pid);
+	fd = open(path, O_RDONLY);
+	if (-1 == fd)
+	{
+		return (0);
+	}
+	
+	len = read(fd, stat, sizeof(stat) - 1);
+	close(fd);
+	if (0 >= len)
+	{
+		return (0);
+	}
+	
+	stat[len] = '\0';
+	
+	/* the name (the 2nd field) is in () and can have spaces in it */
+	field = strrchr(stat, ')');
+	for (i = 2; (NULL != field) && (i < STAT_START_FIELD); ++i)
+	{
+		field = strchr(field + 1, ' ');
+	}
+	
+	return ((NULL != field) ? (uint64_t)strtoull(field + 1, NULL, 10) : 0);
+}
+
+/******************************************************************************/
+
+/* the pid of the process in a slot - a process that died can have left its
+	pid there, and the pid can be someone else's now.
+	returns the pid, or 0 if the process is gone */
+static pid_t LivePidOf(size_t slot)
+{
+	wd_slot_t *other = SlotOf(slot);
+	pid_t pid = other->beat.pid;
+	
+	/* the start time is written before the pid */
+	__sync_synchronize();
+	
+	if ((0 == pid) || (StartTimeOf(pid) != other->beat.start))
+	{
+		return (0);
+	}
+	
+	return (pid);
+}
+
+/******************************************************************************/
+
+/* the lock is robust - when the process that held it died, the next one
+	takes it (every change under it is a few stores, and the last one says
+	that it's done) */
+static void Lock(void)
+{
+	if (EOWNERDEAD == pthread_mutex_lock(&g_shared->head.lock))
+	{
+		pthread_mutex_consistent(&g_shared->head.lock);
+	}
+}
+
+/******************************************************************************/
+
+static void Unlock(void)
+{
+	pthread_mutex_unlock(&g_shared->head.lock);
+}
+
+/******************************************************************************/
+
+/* returns 0 for success */
+static int InitLock(pthread_mutex_t *lock)
+{
+	pthread_mutexattr_t attr;
+	int res = 0;
+	
+	if (0 != pthread_mutexattr_init(&attr))
+	{
+		return (1);
+	}
+	
+	res = ((0 != pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED)) ||
+		   (0 != pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST)) ||
+		   (0 != pthread_mutex_init(lock, &attr)));
+	
+	pthread_mutexattr_destroy(&attr);
+	
+	return (res);
+}
+
+/******************************************************************************/
+
+/* a heartbeat - an atomic add and a store, with no syscall */
+static void Beat(wd_slot_t *slot)
+{
+	__sync_fetch_and_add(&slot->beat.beats, 1);
+	slot->beat.last_beat = SCHTimeNow();
+}
+
+/******************************************************************************/
+
+static void CloseShared(wd_t *wd)
+{
+	if (NULL != g_shared)
+	{
+		/* WDHeartbeat of another thread doesn't beat in the segment after
+			it's gone */
+		wd->self = NULL;
+		__sync_synchronize();
+	
+		munmap(g_shared, SharedSize()); g_shared = NULL;
+	}
+	
+	if (-1 != wd->shared_fd)
+	{
+		close(wd->shared_fd); wd->shared_fd = -1;
+	}
+}
+
+/******************************************************************************/
+
+/* returns 1 if 'fd' is still the segment of the name (and not a new one,
+	that another process made after it was removed) */
+static int IsSameShared(int fd)
+{
+	struct stat st;
+	struct stat other;
+	int other_fd = shm_open(shared_beat_name, O_RDWR, 0);
+	int res = 0;
+	
+	if (-1 == other_fd)
+	{
+		return (0);
+	}
+	
+	res = ((0 == fstat(fd, &st)) && (0 == fstat(other_fd, &other)) &&
+		   (st.st_dev == other.st_dev) && (st.st_ino == other.st_ino));
+	
+	close(other_fd);
+	
+	return (res);
+}
+
+/******************************************************************************/
+
+/* to map the heartbeat segment - the first process creates it, and the
+	others wait until it's ready.
+	a segment that isn't ready in time was left half made (its creator died)
+	- it's removed, and '*is_stale' is 1 */
+static e_error_t MapShared(wd_t *wd, int *is_stale)
+{
+	struct stat st;
+	void *map = NULL;
+	int is_new = 0;
+	size_t i = 0;
+	
+	assert(wd);
+	
+	*is_stale = 0;
+	
+	wd->shared_fd = shm_open(shared_beat_name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	is_new = (-1 != wd->shared_fd);
+	if ((0 == is_new) && (EEXIST == errno))
+	{
+		wd->shared_fd = shm_open(shared_beat_name, O_RDWR, 0);
+	}
+	
+	if (-1 == wd->shared_fd)
+	{
+		return (ERROR_WD_INIT);
+	}
+	
+	/* a new segment is zeros */
+	if ((1 == is_new) && (0 != ftruncate(wd->shared_fd, (off_t)SharedSize())))
+	{
+		shm_unlink(shared_beat_name);
+		CloseShared(wd);
+	
+		return (ERROR_WD_INIT);
+	}
+	
+	memset(&st, 0, sizeof(st));
+	for (i = 0; (0 == fstat(wd->shared_fd, &st)) &&
+				((off_t)SharedSize() != st.st_size) && (i < OPEN_TRIES); ++i)
+	{
+		usleep(OPEN_WAIT_US);
+	}
+	
+	if ((off_t)SharedSize() == st.st_size)
+	{
+		map = mmap(NULL, SharedSize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+				   wd->shared_fd, 0);
+	}
+	else if (1 == IsSameShared(wd->shared_fd))
+	{
+		/* its creator died before it had a size */
+		shm_unlink(shared_beat_name);
+		*is_stale = 1;
+	}
+	
+	if ((NULL == map) || (MAP_FAILED == map))
+	{
+		CloseShared(wd);
+	
+		return (ERROR_WD_INIT);
+	}
+	
+	g_shared = (wd_shared_t *)map;
+	
+	if (1 == is_new)
+	{
+		/* no one could ever use a segment without its lock */
+		if (0 != InitLock(&g_shared->head.lock))
+		{
+			shm_unlink(shared_beat_name);
+			CloseShared(wd);
+	
+			return (ERROR_WD_INIT);
+		}
+	
+		g_shared->head.slots = SLOT_COUNT;
+		__sync_synchronize();
+		g_shared->head.magic = HEARTBEAT_MAGIC;
+	}
+	
+	for (i = 0; (HEARTBEAT_MAGIC != g_shared->head.magic) && (i < OPEN_TRIES); ++i)
+	{
+		usleep(OPEN_WAIT_US);
+	}
+	
+	if (HEARTBEAT_MAGIC != g_shared->head.magic)
+	{
+		/* its creator died before it was ready */
+		if (1 == IsSameShared(wd->shared_fd))
+		{
+			shm_unlink(shared_beat_name);
+			*is_stale = 1;
+		}
+	
+		CloseShared(wd);
+	
+		return (ERROR_WD_INIT);
+	}
+	
+	return (SUCCESS);
+}
+
+/******************************************************************************/
+
+/* a segment that was left half made is made again - once */
+static e_error_t OpenShared(wd_t *wd)
+{
+	e_error_t was_error = SUCCESS;
+	int is_stale = 0;
+	
+	was_error = MapShared(wd, &is_stale);
+	if (1 == is_stale)
+	{
+		was_error = MapShared(wd, &is_stale);
+	}
+	
+	return (was_error);
+}
+
+/******************************************************************************/
+
+/* to take a slot - the first heartbeat says that the process is up */
+static void TakeSlot(wd_t *wd, size_t slot)
+{
+	wd->slot = slot;
+	wd->self = SlotOf(slot);
+	wd->self->beat.start = StartTimeOf(getpid());
+	__sync_synchronize();
+	wd->self->beat.pid = getpid();
+	wd->self->beat.up_since = SCHTimeNow();
+	
+	Beat(wd->self);
+}
+
+/******************************************************************************/
+
+/* to write the args one after the other (with their '\0').
+	returns 0 for success, and 1 if they don't fit */
+static int PackArgs(wd_entry_t *entry, char **argv)
+{
+	size_t used = 0;
+	size_t len = 0;
+	size_t i = 0;
+	
+	for (i = 0; NULL != argv[i]; ++i)
+	{
+		len = strlen(argv[i]) + 1;
+		if ((WD_ARGS_MAX <= i) || (WD_ARGS_SIZE < used + len))
+		{
+			return (1);
+		}
+	
+		memcpy(entry->args + used, argv[i], len);
+		used += len;
+	}
+	
+	entry->argc = (uint32_t)i;
+	
+	return (0 == i);
+}
+
+/******************************************************************************/
+
+/* 'args' is a copy of the args of an entry, and 'argv' has a place for
+	WD_ARGS_MAX + 1 */
+static void UnpackArgs(char *args, uint32_t argc, char **argv)
+{
+	uint32_t i = 0;
+	
+	for (i = 0; i < argc; ++i)
+	{
+		argv[i] = args;
+		args += strlen(args) + 1;
+	}
+	
+	argv[argc] = NULL;
+}
+
+/******************************************************************************/
+
+/* to find a free entry for this app, and write its args there.
+	returns the slot, or 0 if there is none (or the args don't fit) */
+static size_t Claim(const wd_t *wd)
+{
+	wd_entry_t *entry = NULL;
+	size_t slot = 0;
+	
+	for (slot = SLOT_WD + 1; slot < SLOT_COUNT; ++slot)
+	{
+		entry = EntryOf(slot);
+		if (ENTRY_FREE == entry->state)
+		{
+			if (0 != PackArgs(entry, wd->argv))
+			{
+				return (0);
+			}
+	
+			entry->hot_standby = IsHotStandby();
+			++entry->generation;
+			memset(SlotOf(slot), 0, sizeof(wd_slot_t));
+	
+			return (slot);
+		}
+	}
+	
+	return (0);
+}
+
+/******************************************************************************/
+
+/* an app joins the table - in a new slot, or in the slot that it had when
+	the watchdog started it again */
+static e_error_t Register(wd_t *wd)
+{
+	wd_partner_t *watchdog = &wd->partners[SLOT_WD];
+	struct stat st;
+	size_t slot = SlotFromEnv();
+	
+	assert(wd);
+	
+	Lock();
+	
+	/* the watchdog removed the segment when its last app left - the app
+		needs a new segment (and a new watchdog) */
+	if ((0 != fstat(wd->shared_fd, &st)) || (0 == st.st_nlink))
+	{
+		Unlock();
+	
+		return (ERROR_WD_INIT);
+	}
+	
+	if ((SLOT_WD == slot) || (SLOT_COUNT <= slot) ||
+		(ENTRY_READY != EntryOf(slot)->state))
+	{
+		slot = Claim(wd);
+		if (SLOT_WD == slot)
+		{
+			Unlock();
+	
+			return (ERROR_WD_FULL);
+		}
+	}
+	
+	TakeSlot(wd, slot);
+	__sync_synchronize();
+	EntryOf(slot)->state = ENTRY_READY;
+	
+	/* a watchdog that died when no app watched it is started again */
+	watchdog->pid = LivePidOf(SLOT_WD);
+	watchdog->start = SlotOf(SLOT_WD)->beat.start;
+	watchdog->beats = SlotOf(SLOT_WD)->beat.beats;
+	
+	Unlock();
+	
+	unsetenv(SLOT_ENV);
+	
+	return (SUCCESS);
+}
+
+/******************************************************************************/
+
+/* to map the segment, and take a slot there */
+static e_error_t Join(wd_t *wd)
+{
+	e_error_t was_error = ERROR_WD_INIT;
+	size_t tries = 0;
+	
+	assert(wd);
+	
+	if (FROM_WD == StartFrom())
+	{
+		was_error = OpenShared(wd);
+		if (SUCCESS == was_error)
+		{
+			TakeSlot(wd, SLOT_WD);
+		}
+	
+		return (was_error);
+	}
+	
+	for (tries = 0; (ERROR_WD_INIT == was_error) && (tries < JOIN_TRIES); ++tries)
+	{
+		was_error = OpenShared(wd);
+		if (SUCCESS == was_error)
+		{
+			was_error = Register(wd);
+		}
+	
+		if (SUCCESS != was_error)
+		{
+			CloseShared(wd);
+		}
+	}
+	
+	return (was_error);
+}
+
+/******************************************************************************/
+
+/* the watchdog leaves when no app is left. the segment is removed under
+	the lock, so an app that joins now makes a new one (and a new watchdog).
+	returns 1 if it left */
+static int Leave(void)
+{
+	boolean is_empty = 1;
+	size_t i = 0;
+	
+	Lock();
+	
+	for (i = SLOT_WD + 1; i < SLOT_COUNT; ++i)
+	{
+		is_empty &= (ENTRY_READY != EntryOf(i)->state);
+	}
+	
+	if (1 == is_empty)
+	{
+		shm_unlink(shared_beat_name);
+	}
+	
+	Unlock();
+	
+	return (is_empty);
+}
+
+/******************************************************************************/
+
+static int TaskSend(void *args)
+{
+	wd_t *wd = NULL;
+	
+	assert(args);
+	
+	wd = (wd_t *)args;
+	
+	if (0 == g_to_finish)
+	{
+		Beat(wd->self);
+	}
+	else
+	{
+		SCHStop(wd->sched);
+	
+		return (STOP);
+	}
+	
+	return (RERUN);
+}
+
+/******************************************************************************/
+
+/* a pidfd refers to the process itself - not to its pid, that can be reused.
+	returns the pidfd, or -1 if the kernel has none */
+static int OpenPidFd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+	return ((int)syscall(SYS_pidfd_open, pid, 0));
+#else
+	errno = ENOSYS;
+	
+	return (-1);
+#endif
+}
+
+/******************************************************************************/
+
+static int SignalPartner(const wd_partner_t *partner, int sig)
+{
+#ifdef SYS_pidfd_send_signal
+	if (-1 != partner->pid_fd)
+	{
+		return ((int)syscall(SYS_pidfd_send_signal, partner->pid_fd, sig, NULL, 0));
+	}
+#endif
+	
+	return (kill(partner->pid, sig));
+}
+
+/******************************************************************************/
+
+static void StopWatching(wd_partner_t *partner)
+{
+	if (-1 != partner->pid_fd)
+	{
+		SCHRemoveFd(partner->wd->sched, partner->pid_fd);
+		close(partner->pid_fd);
+		partner->pid_fd = -1;
+	}
+}
+
+/******************************************************************************/
+
+/* without a pidfd, the partner can be gone, and its pid someone else's */
+static void KillThePartner(wd_partner_t *partner)
+{
+	if ((0 != partner->pid) &&
+		((-1 != partner->pid_fd) ||
+		 (StartTimeOf(partner->pid) == partner->start)))
+	{
+		SignalPartner(partner, SIGKILL);
+		StopWatching(partner);
+	
+		/* a child that is dead already doesn't stay a zombie */
+		waitpid(partner->pid, NULL, WNOHANG);
+	}
+}
+
+/******************************************************************************/
+
+/* an app that left the table (or another app in its slot) isn't started
+	again */
+static boolean IsWanted(const wd_partner_t *partner)
+{
+	return ((SLOT_WD == partner->slot) ||
+			((ENTRY_READY == EntryOf(partner->slot)->state) &&
+			 (partner->generation == EntryOf(partner->slot)->generation)));
+}
+
+/******************************************************************************/
+
+static void Resurrect(wd_partner_t *partner);
+
+/* the pidfd of the partner is readable when it exits - it's resurrected at
+	once, and not in the next check */
+static int OnPartnerExit(int fd, unsigned int events, void *args)
+{
+	wd_partner_t *partner = (wd_partner_t *)args;
+	
+	(void)fd;
+	(void)events;
+	
+	assert(partner);
+	
+	StopWatching(partner);
+	waitpid(partner->pid, NULL, WNOHANG);
+	
+	/* a partner that dies again before a good check waits for the check,
+		that backs off */
+	if ((0 == g_to_finish) && (0 == partner->respawns) && (1 == IsWanted(partner)))
+	{
+		Resurrect(partner);
+	}
+	
+	return (0);
+}
+
+/******************************************************************************/
+
+/* to watch the pidfd of the partner (without it, only TaskCheck finds
+	that it died) */
+static void Watch(wd_partner_t *partner)
+{
+	if (0 == partner->pid)
+	{
+		return;
+	}
+	
+	partner->pid_fd = OpenPidFd(partner->pid);
+	if ((-1 != partner->pid_fd) &&
+		(StartTimeOf(partner->pid) != partner->start))
+	{
+		close(partner->pid_fd);
+		partner->pid_fd = -1;
+		errno = ESRCH;
+	}
+	
+	if ((-1 == partner->pid_fd) && (ESRCH == errno))
+	{
+		/* the partner is gone, and its pid can be someone else's - it's
+			started again with no kill */
+		partner->pid = 0;
+	}
+	else if ((-1 != partner->pid_fd) &&
+			 (1 == SCHAddFd(partner->wd->sched, partner->pid_fd, EV_IN,
+							&OnPartnerExit, partner)))
+	{
+		close(partner->pid_fd);
+		partner->pid_fd = -1;
+	}
+}
+
+/******************************************************************************/
+
+/* the apps share the watchdog - when another app started a new one, this
+	app watches it too.
+	returns 1 if it's a new watchdog */
+static int FollowWatchdog(wd_partner_t *partner)
+{
+	pid_t pid = LivePidOf(SLOT_WD);
+	
+	if ((0 == pid) || (pid == partner->pid))
+	{
+		return (0);
+	}
+	
+	StopWatching(partner);
+	partner->pid = pid;
+	partner->start = SlotOf(SLOT_WD)->beat.start;
+	partner->beats = SlotOf(SLOT_WD)->beat.beats;
+	partner->respawns = 0;
+	partner->taken = SCHTimeNow();
+	
+	Watch(partner);
+	
+	return (1);
+}
+
 /******************************************************************************/
 
-static void SigHandlerUSR1(int sig)
+/* to copy the environment of the process, without its IS_WD, SLOT_ENV,
+	STANDBY_ENV and WATCHDOG_PID_ENV, and with 'is_wd' ("IS_WD=..."), 'slot'
+	(SLOT_ENV"=...", or NULL), 'standby' (STANDBY_ENV"=1", or NULL) and
+	'watchdog' (WATCHDOG_PID_ENV"=...", or NULL).
+	returns the new array (only the array is allocated), or NULL */
+static char **MakeEnv(const char *is_wd, const char *slot, const char *standby,
+					  const char *watchdog)
 {
-	++g_sig_counter;
+	char **env = NULL;
+	size_t count = 0;
+	size_t i = 0;
+	
+	while (NULL != environ[count])
+	{
+		++count;
+	}
+	
+	env = (char **)malloc((count + 5) * sizeof(char *));
+	if (NULL == env)
+	{
+		return (NULL);
+	}
+	
+	count = 0;
+	for (i = 0; NULL != environ[i]; ++i)
+	{
+		if ((0 != strncmp(environ[i], "IS_WD=", 6)) &&
+			(0 != strncmp(environ[i], SLOT_ENV "=", sizeof(SLOT_ENV))) &&
+			(0 != strncmp(environ[i], STANDBY_ENV "=", sizeof(STANDBY_ENV))) &&
+			(0 != strncmp(environ[i], WATCHDOG_PID_ENV "=",
+						  sizeof(WATCHDOG_PID_ENV))))
+		{
+			env[count] = environ[i];
+			++count;
+		}
+	}
+	
+	env[count] = (char *)is_wd;
+	++count;
+	
+	if (NULL != slot)
+	{
+		env[count] = (char *)slot;
+		++count;
+	}
+	
+	if (NULL != standby)
+	{
+		env[count] = (char *)standby;
+		++count;
+	}
+	
+	if (NULL != watchdog)
+	{
+		env[count] = (char *)watchdog;
+		++count;
+	}
+	
+	env[count] = NULL;
+	
+	return (env);
 }
 
 /******************************************************************************/
-static void SigHandlerUSR2(int sig)
+
+static void RecordSpawn(wd_slot_t *slot, sched_time_t exec, sched_time_t ready)
 {
-	g_to_finish = 1;
+	++slot->beat.spawns;
+	slot->beat.spawn_exec = exec;
+	slot->beat.spawn_ready = ready;
+	
+	if (exec > slot->beat.spawn_exec_max)
+	{
+		slot->beat.spawn_exec_max = exec;
+	}
 }
 
 /******************************************************************************/
 
-static void SigHandlerINT(int sig)
+/* a spawn is done when the new partner beats for the first time */
+static void RecordReady(wd_partner_t *partner)
 {
-	;
+	wd_slot_t *other = SlotOf(partner->slot);
+	
+	if ((0 != partner->spawn_start) &&
+		(other->beat.up_since >= partner->spawn_start))
+	{
+		RecordSpawn(partner->wd->self, partner->spawn_exec,
+					other->beat.up_since - partner->spawn_start);
+		partner->spawn_start = 0;
+	}
 }
 
 /******************************************************************************/
 
-static void SetSignalHandler(void)
+/* the partner is started by posix_spawn - vfork and exec, with no copy of
+	the page tables of this process (a fork of a big process is a long
+	downtime), and with the error of the exec returned here.
+	an app is started with the args from its entry, and with its slot.
+	'standby' (STANDBY_ENV"=1", or NULL) makes the app a standby, that knows
+	its watchdog.
+	returns 0 for success, and 1 for failure */
+static int Spawn(const wd_partner_t *partner, pid_t *pid, const char *standby)
 {
-	struct sigaction handle;
-	memset(&handle, 0, sizeof(handle));
+	char args[WD_ARGS_SIZE];
+	char *argv[WD_ARGS_MAX + 1];
+	char slot[NAME_SIZE];
+	char watchdog[NAME_SIZE];
+	char **env = NULL;
+	char **spawn_argv = partner->wd->argv;
+	const char *path = WATCHDOG_FILE_PATH;
+	int res = 0;
+	
+	if (SLOT_WD == partner->slot)
+	{
+		env = MakeEnv("IS_WD=1", NULL, NULL, NULL);
+	}
+	else
+	{
+		memcpy(args, EntryOf(partner->slot)->args, WD_ARGS_SIZE);
+		UnpackArgs(args, EntryOf(partner->slot)->argc, argv);
+		spawn_argv = argv;
+		path = argv[0];
+	
+		sprintf(slot, "%s=%lu", SLOT_ENV, (unsigned long)partner->slot);
+		sprintf(watchdog, "%s=%ld", WATCHDOG_PID_ENV, (long)getpid());
+		env = MakeEnv("IS_WD=0", slot, standby,
+					  (NULL != standby) ? watchdog : NULL);
+	}
 	
-	handle.sa_handler = &SigHandlerUSR1;
-	sigaction(SIGUSR1, &handle, NULL);
+	/* it returns after the exec of the child */
+	res = ((NULL == env) ||
+		   (0 != posix_spawnp(pid, path, NULL, NULL, spawn_argv, env)));
 	
-	handle.sa_handler = &SigHandlerUSR2;
-	sigaction(SIGUSR2, &handle, NULL);
+	free(env); env = NULL;
 	
-	handle.sa_handler = &SigHandlerINT;
-	sigaction(SIGINT, &handle, NULL);
-}	
+	return (res);
+}
 
-/******************************************************************************/
-/* 			                Help Functions                                    */  
 /******************************************************************************/
 
-static boolean IsFirstWDLoad()
+/* a standby is an app that was spawned with STANDBY_ENV, did its (long)
+	init, and waits in StartWD. this releases it to be the app.
+	returns 1 if a standby was released, and 0 if there is none */
+static int ReleaseStandby(wd_partner_t *partner, pid_t *pid)
 {
-	/* return error if the semaphore exist */
-	sem_lock = sem_open(shared_sem_name, O_CREAT | O_EXCL, 0644, 0);
+	if ((0 == partner->standby) ||
+		(0 != waitpid(partner->standby, NULL, WNOHANG)))
+	{
+		partner->standby = 0;
+	
+		return (0);
+	}
+	
+	*pid = partner->standby;
+	partner->standby = 0;
+	sem_post(partner->standby_sem);
 	
-	return (EEXIST != errno);
+	return (1);
 }
 
 /******************************************************************************/
 
-static boolean IsFileExist(const char *file_path)
+/* to spawn a new standby, if the app has one and it has none (or it
+	died) - it inits itself in the background.
+	not while a spawn is in progress - a new standby could take the post of
+	the semaphore before the one that was released wakes up */
+static void KeepStandby(wd_partner_t *partner)
 {
-	return (0 == access(file_path, F_OK));
+	if ((NULL == partner->standby_sem) || (0 != partner->spawn_start) ||
+		(0 != g_to_finish))
+	{
+		return;
+	}
+	
+	if ((0 != partner->standby) &&
+		(0 != waitpid(partner->standby, NULL, WNOHANG)))
+	{
+		partner->standby = 0;
+	}
+	
+	if ((0 == partner->standby) &&
+		(0 != Spawn(partner, &partner->standby, STANDBY_ENV "=1")))
+	{
+		partner->standby = 0;
+	}
 }
 
 /******************************************************************************/
 
-static e_start_from_t StartFrom(void)
+static void Resurrect(wd_partner_t *partner)
 {
-	return ((0 == strcmp(getenv("IS_WD"), "1")) ? FROM_WD : FROM_APP);
+	wd_slot_t *other = SlotOf(partner->slot);
+	pid_t child_pid = 0;
+	pid_t live_pid = 0;
+	sched_time_t start = 0;
+	
+	/* the apps share the watchdog - only the first one that finds it dead
+		starts a new one, and the others follow it. the lock is only held to
+		mark the spawn, and to publish its pid - not for the spawn itself */
+	if (SLOT_WD == partner->slot)
+	{
+		Lock();
+	
+		live_pid = LivePidOf(SLOT_WD);
+		if ((0 != live_pid) && (live_pid != partner->pid))
+		{
+			Unlock();
+			FollowWatchdog(partner);
+	
+			return;
+		}
+	
+		/* another app spawns it now - it's followed in the next check
+			(unless that app died in the middle) */
+		if ((0 != other->beat.spawner) &&
+			(StartTimeOf(other->beat.spawner) == other->beat.spawner_start))
+		{
+			Unlock();
+	
+			return;
+		}
+	
+		other->beat.spawner_start = StartTimeOf(getpid());
+		other->beat.spawner = getpid();
+	
+		Unlock();
+	}
+	
+	/* to be sure that the child doesn't exist */
+	KillThePartner(partner);
+	
+	/* the new partner beats once when it's up */
+	partner->beats = other->beat.beats;
+	
+	start = SCHTimeNow();
+	
+	/* a standby is up already - only a cold start waits for the init */
+	if ((0 == ReleaseStandby(partner, &child_pid)) &&
+		(0 != Spawn(partner, &child_pid, NULL)))
+	{
+		/* the next check tries again */
+		child_pid = 0;
+	}
+	else
+	{
+		partner->spawn_exec = SCHTimeNow() - start;
+		partner->spawn_start = start;
+		partner->taken = start;
+		++partner->respawns;
+	}
+	
+	/* the child isn't waited for yet - its pid is its own */
+	partner->pid = child_pid;
+	partner->start = (0 != child_pid) ? StartTimeOf(child_pid) : 0;
+	
+	if (SLOT_WD == partner->slot)
+	{
+		Lock();
+	
+		other->beat.start = partner->start;
+		__sync_synchronize();
+		other->beat.pid = child_pid;
+		other->beat.spawner = 0;
+	
+		Unlock();
+	}
+	
+	Watch(partner);
+	KeepStandby(partner);
 }
 
 /******************************************************************************/
 
-static void CleanAll(wd_t *wd)
+static int TaskCheck(void *args, sched_time_t *next)
 {
-	assert(wd);
+	wd_partner_t *partner = NULL;
+	wd_slot_t *other = NULL;
+	size_t i = 0;
+	int is_beating = 0;
 	
-	SCHDestroy(wd->sched); wd->sched = NULL;
+	assert(args);
+	
+	partner = (wd_partner_t *)args;
+	other = SlotOf(partner->slot);
+	*next = SCH_MSEC(CHECK_INTERVAL_MS);
+	
+	/* a new watchdog (that another app started) gets a full interval */
+	if ((SLOT_WD == partner->slot) && (1 == FollowWatchdog(partner)))
+	{
+		return (SCH_NEXT_AFTER);
+	}
+	
+	RecordReady(partner);
+	
+	/* a new partner (that was spawned, or that another app started) gets a
+		full interval to beat - the spawn doesn't wait for it */
+	if ((0 != partner->taken) &&
+		(SCH_MSEC(CHECK_INTERVAL_MS) > SCHTimeNow() - partner->taken))
+	{
+		return (SCH_NEXT_AFTER);
+	}
+	
+	partner->taken = 0;
+	
+	is_beating = (other->beat.beats != partner->beats);
+	
+	/* there is no partner because it's the first time, or it hangs
+		(or it died again - see OnPartnerExit) */
+	if (((0 == is_beating) || (0 == partner->pid)) && (0 == g_to_finish) &&
+		(1 == IsWanted(partner)))
+	{
+		Resurrect(partner);
+	}
+	else if (1 == is_beating)
+	{
+		partner->respawns = 0;
+	}
+	
+	/* the next check needs new heartbeats */
+	partner->beats = other->beat.beats;
+	
+	KeepStandby(partner);
+	
+	/* a partner that dies again and again is checked less and less often
+		(the first one, and a partner that lives, every CHECK_INTERVAL_MS) */
+	for (i = 1; (i < partner->respawns) && (*next < SCH_MSEC(CHECK_BACKOFF_MAX_MS)); ++i)
+	{
+		*next *= 2;
+	}
+	
+	if (*next > SCH_MSEC(CHECK_BACKOFF_MAX_MS))
+	{
+		*next = SCH_MSEC(CHECK_BACKOFF_MAX_MS);
+	}
 	
-	sem_unlink(shared_sem_name);
+	return (SCH_NEXT_AFTER);
 }
 
 /******************************************************************************/
 
-static int TaskSend(void *args)
+/* to let go of a partner - its pidfd and its standby (the partner itself
+	lives on) */
+static void Forget(wd_partner_t *partner)
 {
-	wd_t *wd = NULL;
+	char name[NAME_SIZE];
 	
-	assert(args);
+	StopWatching(partner);
 	
-	wd = (wd_t *)args;
+	if (0 != partner->standby)
+	{
+		kill(partner->standby, SIGKILL);
+		waitpid(partner->standby, NULL, 0);
+		partner->standby = 0;
+	}
 	
-	if (0 == g_to_finish)
+	if (NULL != partner->standby_sem)
 	{
-		kill(wd->partner, SIGUSR1);
+		sem_close(partner->standby_sem); partner->standby_sem = NULL;
+		StandbySemName(name, partner->slot);
+		sem_unlink(name);
 	}
-	else
+	
+	/* a child that is dead already doesn't stay a zombie */
+	if (0 != partner->pid)
 	{
-		SCHStop(wd->sched);
-		
-		return (STOP);
+		waitpid(partner->pid, NULL, WNOHANG);
 	}
 	
-	return (RERUN);
+	partner->pid = 0;
+	partner->is_watched = 0;
 }
 
 /******************************************************************************/
 
-static void KillTheChildProcess(pid_t pid)
+/* the watchdog watches a new app in the table - with its own check */
+static void Adopt(wd_t *wd, size_t slot)
 {
-	if (0 != pid)
+	wd_partner_t *partner = &wd->partners[slot];
+	char name[NAME_SIZE];
+	
+	partner->check = SCHAddDynamic(wd->sched, &TaskCheck, (void *)partner,
+								 SCH_MSEC(CHECK_INTERVAL_MS),
+								  SCH_MSEC(TASK_SLACK_MS));
+	if (1 == UIDIsBad(partner->check))
+	{
+		/* the next scan tries again */
+		return;
+	}
+	
+	SCHSetCatchUp(wd->sched, partner->check, SCH_CATCH_UP_COALESCE);
+	
+	partner->pid = LivePidOf(slot);
+	partner->start = SlotOf(slot)->beat.start;
+	partner->beats = SlotOf(slot)->beat.beats;
+	partner->generation = EntryOf(slot)->generation;
+	partner->respawns = 0;
+	partner->spawn_start = 0;
+	partner->is_watched = 1;
+	
+	if (1 == EntryOf(slot)->hot_standby)
 	{
-		kill(pid, SIGKILL);
+		/* an old semaphore can have a count that would release a standby */
+		StandbySemName(name, slot);
+		sem_unlink(name);
+		partner->standby_sem = sem_open(name, O_CREAT | O_EXCL, 0644, 0);
+		if (SEM_FAILED == partner->standby_sem)
+		{
+			partner->standby_sem = NULL;
+		}
 	}
+	
+	Watch(partner);
+	KeepStandby(partner);
 }
 
 /******************************************************************************/
 
-static int TaskCheck(void *args)
+/* the watchdog lets go of the apps that left the table, watches the ones
+	that joined it, and leaves when there is none */
+static int TaskScan(void *args)
 {
-	pid_t child_pid = 0;
 	wd_t *wd = NULL;
+	wd_partner_t *partner = NULL;
+	size_t watched = 0;
+	size_t i = 0;
 	
 	assert(args);
 	
 	wd = (wd_t *)args;
 	
-	/* there is no partner because it's the first time, or it was terminated */
-	if (((0 == g_sig_counter) || (0 == wd->partner)) && (0 == g_to_finish))
+	for (i = SLOT_WD + 1; i < SLOT_COUNT; ++i)
 	{
-		/* to be sure that the child doesn't exist */
-		KillTheChildProcess(wd->partner);
-
-		child_pid = fork();
-		if (0 == child_pid)
+		partner = &wd->partners[i];
+	
+		if ((1 == partner->is_watched) && (0 == IsWanted(partner)))
 		{
-			
-			if (FROM_WD == StartFrom())
-			{
-				setenv("IS_WD", "0", 1);
-				execvp(wd->argv[0], wd->argv);
-			}
-			else
-			{
-				setenv("IS_WD", "1", 1);
-				execvp(WATCHDOG_FILE_PATH, wd->argv);
-			}
+			SCHRemove(wd->sched, partner->check);
+			Forget(partner);
 		}
-		else /* from the parent */
+	
+		if ((0 == partner->is_watched) && (ENTRY_READY == EntryOf(i)->state))
 		{
-			wd->partner = child_pid;
-			wd->is_parent_process = 1;
-			
-			sem_wait(sem_lock);
+			Adopt(wd, i);
 		}
+	
+		watched += partner->is_watched;
 	}
 	
-	g_sig_counter = 0;
+	if ((0 == watched) && (1 == Leave()))
+	{
+		g_to_finish = 1;
+		SCHStop(wd->sched);
+	
+		return (STOP);
+	}
 	
 	return (RERUN);
 }
 
 /******************************************************************************/
 
-static e_error_t InitWD(wd_t *wd, char **argv)
+static void CleanAll(wd_t *wd)
 {
-	assert(argv);
+	size_t i = 0;
+	
 	assert(wd);
 	
-	wd->sched = SCHCreate();
-	if (NULL == wd->sched)
+	for (i = 0; i < SLOT_COUNT; ++i)
 	{
-		return (ERROR_SCHED);
+		Forget(&wd->partners[i]);
 	}
 	
-	wd->partner = getppid();
-	wd->is_parent_process = 0;
-	wd->argv = argv;
-
-	return (SUCCESS);	
+	SCHDestroy(wd->sched); wd->sched = NULL;
+	
+	/* the app leaves the table after its last heartbeat - the watchdog lets
+		go of it (and leaves when it was the last app), and a new app that
+		takes the slot isn't beaten for by this one */
+	if ((FROM_APP == StartFrom()) && (NULL != wd->self))
+	{
+		Lock();
+		EntryOf(wd->slot)->state = ENTRY_FREE;
+		Unlock();
+	}
+	
+	CloseShared(wd);
 }
 
 /******************************************************************************/
 
-static e_error_t SetAttr(pthread_attr_t attr)
+static e_error_t InitWD(wd_t *wd, char **argv)
 {
-	e_error_t was_error = SUCCESS;
+	size_t i = 0;
 	
-	if (FROM_APP == StartFrom())
+	assert(argv);
+	assert(wd);
+	
+	wd->sched = SCHCreate();
+	if (NULL == wd->sched)
 	{
-		if (0 != pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED))
-		{
-			was_error = ERROR_THREAD;
-		}
+		return (ERROR_SCHED);
 	}
-	else
+	
+	wd->argv = argv;
+	wd->slot = SLOT_WD;
+	wd->self = NULL;
+	wd->shared_fd = -1;
+	wd->is_thread = 0;
+	
+	memset(wd->partners, 0, sizeof(wd->partners));
+	for (i = 0; i < SLOT_COUNT; ++i)
 	{
-		if (0 != pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE))
-		{	
-			was_error = ERROR_THREAD;
-		}
+		wd->partners[i].wd = wd;
+		wd->partners[i].slot = i;
+		wd->partners[i].pid_fd = -1;
 	}
-
-	return (was_error);
+	
+	return (SUCCESS);
 }
 
 /******************************************************************************/
 
-static e_error_t LoadSched(const wd_t *wd)
+static e_error_t LoadSched(wd_t *wd)
 {
+	wd_partner_t *watchdog = &wd->partners[SLOT_WD];
 	uid_type result_send = { 0 };
 	uid_type result_check = { 0 };
 	
 	assert(wd);
-
-	result_send = SCHAdd(wd->sched, &TaskSend, (void *)wd, SEND_INTERVAL);
-	result_check = SCHAdd(wd->sched, &TaskCheck, (void *)wd, CHECK_INTERVAL);
+	
+	/* a little slack lets the tasks (and the partners) share wake ups.
+		the watchdog scans the table, and an app checks the watchdog */
+	result_send = SCHAddWithSlack(wd->sched, &TaskSend, (void *)wd,
+								  SCH_MSEC(SEND_INTERVAL_MS),
+								  SCH_MSEC(TASK_SLACK_MS));
+	if (FROM_WD == StartFrom())
+	{
+		result_check = SCHAddWithSlack(wd->sched, &TaskScan, (void *)wd,
+									   SCH_MSEC(SEND_INTERVAL_MS),
+									   SCH_MSEC(TASK_SLACK_MS));
+	}
+	else
+	{
+		result_check = SCHAddDynamic(wd->sched, &TaskCheck, (void *)watchdog,
+									 SCH_MSEC(CHECK_INTERVAL_MS),
+									 SCH_MSEC(TASK_SLACK_MS));
+	}
 	
 	if ((1 == UIDIsBad(result_send)) || (1 == UIDIsBad(result_check)))
 	{
 		return (ERROR_TASK);
 	}
 	
-	if (0 == wd->is_parent_process)
+	/* after a pause (a stopped process), one heartbeat and one check are done
+		for all the missed periods - not a burst of them */
+	SCHSetCatchUp(wd->sched, result_send, SCH_CATCH_UP_COALESCE);
+	SCHSetCatchUp(wd->sched, result_check, SCH_CATCH_UP_COALESCE);
+	
+	/* the watchdog takes the apps that are in the table now, and an app
+		without a watchdog starts it */
+	if (FROM_WD == StartFrom())
+	{
+		if (STOP == TaskScan(wd))
+		{
+			return (ERROR_WD_INIT);
+		}
+	}
+	else if (0 == watchdog->pid)
 	{
-		sem_post(sem_lock);
+		Resurrect(watchdog);
 	}
-
+	else
+	{
+		Watch(watchdog);
+	}
+	
 	return (SUCCESS);
 }
 
@@ -285,10 +1534,7 @@ void *SignalPingPong(void *args)
 	
 	wd = (wd_t *)args;
 	
-	if (SUCCESS == LoadSched(wd))
-	{
-		SCHRun(wd->sched);
-	}
+	SCHRun(wd->sched);
 	
 	CleanAll(wd);
 	
@@ -297,44 +1543,33 @@ void *SignalPingPong(void *args)
 
 /******************************************************************************/
 
+/* the watchdog runs the scheduler until it leaves. in an app the thread
+	stays joinable - StopWD waits for it */
 static e_error_t RunThread(wd_t *wd)
 {
-	pthread_t thread = 0;
-	pthread_attr_t attr;
-	e_error_t was_error = SUCCESS;
-	
 	assert(wd);
 	
-	if (0 != pthread_attr_init(&attr))
+	if (0 != pthread_create(&wd->thread, NULL, &SignalPingPong, (void *)wd))
 	{
 		return (ERROR_THREAD);
 	}
 	
-	was_error = SetAttr(attr);
-	
-	if ((SUCCESS == was_error) &&
-		(0 != pthread_create(&thread, &attr, &SignalPingPong, (void *)wd)))
-	{
-		was_error = ERROR_THREAD;
-	}
-
-	if ((SUCCESS == was_error) && (FROM_WD == StartFrom()))
+	if (FROM_APP == StartFrom())
 	{
-		if (0 != pthread_join(thread, NULL))
-		{
-			was_error = ERROR_THREAD;
-		}
-	}
+		wd->is_thread = 1;
 	
-	pthread_attr_destroy(&attr);
+		return (SUCCESS);
+	}
 	
-	return (was_error);
+	return ((0 != pthread_join(wd->thread, NULL)) ? ERROR_THREAD : SUCCESS);
 }
 
 /******************************************************************************/
 
 int StartWD(char **argv)
 {
+	e_error_t was_error = SUCCESS;
+	
 	assert(argv);
 	
 	/* check if the WD exist */
@@ -342,7 +1577,13 @@ int StartWD(char **argv)
 	{
 		return (ERROR_WD_DONT_EXIST);
 	}
-
+	
+	/* a standby waits here (after the init of the app) until it's needed */
+	if (NULL != getenv(STANDBY_ENV))
+	{
+		ParkAsStandby();
+	}
+	
 	/* init the struct */
 	if (ERROR_SCHED == InitWD(&wd, argv))
 	{
@@ -352,24 +1593,29 @@ int StartWD(char **argv)
 	/* set signals */
 	SetSignalHandler();
 	
-	if (1 == IsFirstWDLoad())
+	/* the heartbeats, and the table of the apps that the watchdog watches */
+	was_error = Join(&wd);
+	if (SUCCESS != was_error)
 	{
-		/* to add a new environment var and write there that it's not WD */
-		setenv("IS_WD", "0", 1);
-		wd.partner = 0;
-		wd.is_parent_process = 1;
+		CleanAll(&wd);
+	
+		return (was_error);
 	}
-	else
+	
+	/* the tasks are added by this thread, that created the scheduler,
+		before the thread of the scheduler takes them */
+	if (SUCCESS != LoadSched(&wd))
 	{
-		/* joining to the sen */
-		sem_lock = sem_open(shared_sem_name, 0);	
+		CleanAll(&wd);
+	
+		return (ERROR_TASK);
 	}
-		
+	
 	/* set thread */
 	if (SUCCESS != RunThread(&wd))
 	{
 		CleanAll(&wd);
-		
+	
 		return (ERROR_THREAD);
 	}
 	
@@ -380,15 +1626,43 @@ int StartWD(char **argv)
 
 void StopWD(void)
 {
-	size_t times_to_try = 0;
-	
 	/* changes the flag to start clean process */
 	g_to_finish = 1;
 	
-	/* trying to send SIGUSR to the child to sign him to start clean the process,
-	   try num of time to check if t */
-	for (times_to_try = 0; times_to_try < TRY_TO_CLOSE_PROCESS; ++times_to_try)
+	/* the thread stops at its next heartbeat, and unmaps the segment -
+		nothing of the watchdog is used after StopWD returns */
+	if (1 == wd.is_thread)
+	{
+		pthread_join(wd.thread, NULL);
+		wd.is_thread = 0;
+	}
+}
+
+/******************************************************************************/
+
+void WDHeartbeat(void)
+{
+	wd_slot_t *self = wd.self;
+	
+	if (NULL != self)
+	{
+		Beat(self);
+	}
+}
+
+/******************************************************************************/
+
+void WDGetSpawnStats(wd_spawn_stats_t *stats)
+{
+	assert(stats);
+	
+	memset(stats, 0, sizeof(*stats));
+	
+	if (NULL != wd.self)
 	{
-		kill(wd.partner, SIGUSR2);
+		stats->spawns = (unsigned long)wd.self->beat.spawns;
+		stats->exec_ns = (long)wd.self->beat.spawn_exec;
+		stats->exec_max_ns = (long)wd.self->beat.spawn_exec_max;
+		stats->ready_ns = (long)wd.self->beat.spawn_ready;
 	}
 }
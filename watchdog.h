@@ -15,9 +15,19 @@ typedef enum
 	ERROR_TASK,
 	ERROR_THREAD,
 	ERROR_WD_DONT_EXIST,
-	ERROR_WD_INIT	
+	ERROR_WD_INIT,
+	ERROR_WD_FULL			/* the table of the watchdog has no room for the app */
 }e_error_t;
 
+/* the times of the partners that this process spawned (in nanoseconds) */
+typedef struct
+{
+	unsigned long spawns;
+	long exec_ns;			/* the last spawn - until the exec of the partner */
+	long exec_max_ns;
+	long ready_ns;			/* the last spawn - until the partner was up */
+}wd_spawn_stats_t;
+
 /****************************************************************************/
 /*	Function Name - StartWD		              		    				    */
 /*	Parameter:																*/
@@ -27,6 +37,12 @@ typedef enum
 /*	Description:															*/
 /*		the function runing a watchdog to protect on a process,				*/
 /*		if the process is down, the watchdog re-start it.					*/
+/*		one watchdog watches all the apps that call it - the first app		*/
+/*		starts it. ERROR_WD_FULL - there is no room for one more app (or	*/
+/*		its args are too long).												*/
+/*		with WD_HOT_STANDBY=1 in the environment, the watchdog keeps a		*/
+/*		standby of the app, that waits inside StartWD - so the init of		*/
+/*		the app has to be done before it.									*/
 /****************************************************************************/
 int StartWD(char **argv);
 
@@ -38,8 +54,39 @@ int StartWD(char **argv);
 /*		nothing.		  									                */ 
 /*	Description:															*/
 /*		the function stop the watchdog and destroy is resources.			*/
+/*		the app leaves the watchdog, that stops when no app is left.		*/
+/*		it waits for the thread of the watchdog to stop (up to a second).	*/
 /****************************************************************************/
 void StopWD(void);
 
+/****************************************************************************/
+/*	Function Name - WDHeartbeat		              		    				*/
+/*	Parameter:																*/
+/*		nothing.       						         		 		        */
+/*	Return Value:															*/
+/*		nothing.		  									                */ 
+/*	Description:															*/
+/*		a heartbeat of the process to its watchdog, from its own loop.		*/
+/*		it's an atomic add and a store to shared memory - no syscall and	*/
+/*		no signal, so it can be called as often as needed.					*/
+/*		(the watchdog thread sends one every second anyway.)				*/
+/*		call it between StartWD and StopWD only - not after StopWD, and		*/
+/*		not from another thread while StopWD runs.							*/
+/****************************************************************************/
+void WDHeartbeat(void);
+
+/****************************************************************************/
+/*	Function Name - WDGetSpawnStats		              		    			*/
+/*	Parameter:																*/
+/*		a struct for the stats.		         		 		        		*/
+/*	Return Value:															*/
+/*		nothing.		  									                */ 
+/*	Description:															*/
+/*		the function gets how long the spawns of the partners took.			*/
+/*		the stats are also in the shared segment, for other tools.			*/
+/*		call it between StartWD and StopWD only.							*/
+/****************************************************************************/
+void WDGetSpawnStats(wd_spawn_stats_t *stats);
+
 
 #endif	/* WD_H */	
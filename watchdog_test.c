@@ -14,6 +14,8 @@ int main(int argc, char *argv[])
 	size_t counter = 0;
 	char input[4] = {0};
 	
+	(void)argc;
+	
 	strcpy(input, argv[2]);
 	
 	printf("run agin %d\n", getpid());
@@ -6,6 +6,8 @@
 
 int main(int argc, char **argv)
 {
+	(void)argc;
+
 	StartWD(argv);
 	StopWD();
 